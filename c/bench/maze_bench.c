@@ -0,0 +1,451 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "../maze_generator/maze_generator.h"
+#include "../maze_render/maze_render.h"
+#include "../bmp/bmp.h"
+#include "../png/png.h"
+#include "../rng/rng.h"
+#include "../threadpool/threadpool.h"
+
+typedef struct Point   Point;
+typedef struct Maze    Maze;
+typedef struct BmpImage BmpImage;
+typedef struct BmpFormat BmpFormat;
+typedef struct Rng     Rng;
+typedef struct ThreadPool ThreadPool;
+
+#define MAX_LIST 32 /* values per swept option */
+
+/* the timed phases of one run, in order */
+enum Phase { PHASE_CREATE, PHASE_GENERATE, PHASE_RENDER, PHASE_SAVE, PHASE_TOTAL, PHASE_COUNT };
+
+static const char *PHASE_NAMES[PHASE_COUNT] = { "create", "generate", "render", "save", "total" };
+
+/* an output the image is rendered and saved as */
+struct Output {
+    const char *name;
+    int bpp;
+    int png;
+};
+
+static const struct Output OUTPUTS[] = {
+    { "bmp24", 24, 0 }, { "bmp8", 8, 0 }, { "bmp1", 1, 0 },
+    { "png24", 24, 1 }, { "png8", 8, 1 }, { "png1", 1, 1 },
+};
+
+/* the swept values and how every configuration is run */
+struct Sweep {
+    size_t widths[MAX_LIST], heights[MAX_LIST];
+    int n_dims;
+    int cells[MAX_LIST];
+    int n_cells;
+    int walls[MAX_LIST];
+    int n_walls;
+    unsigned long long seeds[MAX_LIST];
+    int n_seeds;
+    enum MazeAlgorithm algos[MAX_LIST];
+    int n_algos;
+    const struct Output *outputs[MAX_LIST];
+    int n_outputs;
+    int warmup, trials;
+    int csv;
+    const char *dir;
+};
+
+/* one configuration of the sweep */
+struct Config {
+    size_t width, height;
+    int cell, wall;
+    unsigned long long seed;
+    enum MazeAlgorithm algo;
+    const struct Output *output;
+};
+
+/* print usage to stderr; doesn't exit() so caller controls exit code */
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [OPTIONS]\n\n"
+        "Runs every combination of the swept values and reports median and p95\n"
+        "times of each phase with cells/s, pixels/s, output MB/s and peak RSS.\n\n"
+        "Options (lists are comma-separated):\n"
+        "  -d, --dims LIST           Maze dimensions, WxH (default: 100x100,1000x1000)\n"
+        "  -c, --cell LIST           Cell sizes in pixels (default: 4,10)\n"
+        "  -w, --wall LIST           Wall thicknesses in pixels (default: 1)\n"
+        "      --seeds LIST          RNG seeds (default: 1)\n"
+        "      --algo LIST           Algorithms: dfs, eller, tiled, kruskal,\n"
+        "                            kruskal-mt, dfs-blocked, binary-tree,\n"
+        "                            sidewinder, growing-newest, growing-random,\n"
+        "                            growing-oldest, growing-mixed (default: all)\n"
+        "      --output LIST         Outputs: bmp24, bmp8, bmp1, png24, png8, png1\n"
+        "                            (default: bmp24,png8)\n"
+        "      --warmup N            Untimed runs before each configuration (default: 1)\n"
+        "      --trials N            Timed runs per configuration (default: 5)\n"
+        "      --threads N           Worker threads, 0 = one per CPU (default: 0)\n"
+        "      --format json|csv     Results format (default: json)\n"
+        "  -o, --out <path>          Results file (default: stdout)\n"
+        "      --dir <path>          Directory for the images being saved (default: .)\n"
+        "  -h, --help                Show this help and exit\n",
+        prog
+    );
+}
+
+static double diff_ms(const struct timespec *start, const struct timespec *end) {
+    double sec  = (double)(end->tv_sec  - start->tv_sec);
+    double nsec = (double)(end->tv_nsec - start->tv_nsec);
+    return sec * 1e3 + nsec / 1e6;
+}
+
+/* split a comma-separated list in place; returns the item count, or -1 if
+   there are more than MAX_LIST */
+static int split_list(char *list, char **items) {
+    int n = 0;
+    for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        if (n == MAX_LIST) return -1;
+        items[n++] = tok;
+    }
+    return n;
+}
+
+static int parse_sweep_option(struct Sweep *sw, int opt, char *arg) {
+    char *items[MAX_LIST];
+    int n = split_list(arg, items);
+    if (n <= 0) return 0;
+
+    for (int i = 0; i < n; ++i) {
+        switch (opt) {
+            case 'd':
+                if (sscanf(items[i], "%zux%zu", &sw->widths[i], &sw->heights[i]) != 2 ||
+                    sw->widths[i] == 0 || sw->heights[i] == 0) return 0;
+                break;
+            case 'c':
+                sw->cells[i] = atoi(items[i]);
+                if (sw->cells[i] <= 2) return 0;
+                break;
+            case 'w':
+                sw->walls[i] = atoi(items[i]);
+                if (sw->walls[i] < 1) return 0;
+                break;
+            case 1:
+                sw->seeds[i] = strtoull(items[i], NULL, 10);
+                break;
+            case 2:
+                if (!maze_algorithm_from_name(items[i], &sw->algos[i])) return 0;
+                break;
+            case 3: {
+                sw->outputs[i] = NULL;
+                for (size_t k = 0; k < sizeof OUTPUTS / sizeof OUTPUTS[0]; ++k) {
+                    if (strcmp(items[i], OUTPUTS[k].name) == 0) sw->outputs[i] = &OUTPUTS[k];
+                }
+                if (!sw->outputs[i]) return 0;
+                break;
+            }
+        }
+    }
+
+    switch (opt) {
+        case 'd': sw->n_dims = n; break;
+        case 'c': sw->n_cells = n; break;
+        case 'w': sw->n_walls = n; break;
+        case 1:   sw->n_seeds = n; break;
+        case 2:   sw->n_algos = n; break;
+        case 3:   sw->n_outputs = n; break;
+    }
+    return 1;
+}
+
+/* fill a grid with the chosen algorithm through the generator registry */
+static bool generate_grid(Maze *m, enum MazeAlgorithm algo, Rng *rng, ThreadPool *pool) {
+    struct MazeGenContext ctx = { m, rng, pool, MAZE_GROW_NEWEST_PERCENT, NULL };
+    return maze_generator_run(maze_generator_find(algo), &ctx);
+}
+
+/* the peak resident set size is a process-wide high-water mark; on Linux it
+   can be reset, so each configuration reports its own peak, elsewhere it is
+   the peak of the sweep so far */
+static void reset_peak_rss(void) {
+    FILE *fp = fopen("/proc/self/clear_refs", "w");
+    if (!fp) return;
+    fputs("5", fp);
+    fclose(fp);
+}
+
+static long peak_rss_kb(void) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp) {
+        char line[256];
+        long kb = -1;
+        while (fgets(line, sizeof line, fp)) {
+            if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) break;
+        }
+        fclose(fp);
+        if (kb >= 0) return kb;
+    }
+#ifndef _WIN32
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) return ru.ru_maxrss;
+#endif
+    return 0;
+}
+
+/* one create/generate/render/save run; ms gets the phase times and
+   *file_bytes the size of the saved image */
+static bool run_once(const struct Config *c, const char *path, ThreadPool *pool, double ms[PHASE_COUNT], long *file_bytes) {
+    struct timespec t[PHASE_TOTAL + 1];
+    Point start = { 0, 0 };
+    Point end = { (int64_t)c->width - 1, (int64_t)c->height - 1 };
+    struct MazeRenderConfig cfg = { c->cell, c->wall, MAZE_BG_COLOR, MAZE_WALL_COLOR, MAZE_START_COLOR,
+                                    MAZE_END_COLOR, MAZE_PATH_COLOR, c->output->bpp, c->output->bpp != 1, NULL };
+    BmpFormat fmt;
+    maze_render_format(&cfg, &fmt);
+
+    clock_gettime(CLOCK_MONOTONIC, &t[PHASE_CREATE]);
+    Maze *m = maze_create(c->width, c->height, c->cell, start, end, c->wall);
+    BmpImage *img = bmp_create_format((int)(c->width * c->cell), (int)(c->height * c->cell), &fmt);
+    bool ok = m && img;
+
+    clock_gettime(CLOCK_MONOTONIC, &t[PHASE_GENERATE]);
+    if (ok) {
+        Rng rng;
+        rng_seed(&rng, c->seed);
+        ok = generate_grid(m, c->algo, &rng, pool);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t[PHASE_RENDER]);
+    if (ok) maze_render_to_bmp(m, img, &cfg, pool);
+
+    clock_gettime(CLOCK_MONOTONIC, &t[PHASE_SAVE]);
+    if (ok) ok = c->output->png ? png_save(path, img, pool) : bmp_save(path, img);
+
+    clock_gettime(CLOCK_MONOTONIC, &t[PHASE_TOTAL]);
+    for (int p = 0; p < PHASE_TOTAL; ++p) {
+        ms[p] = diff_ms(&t[p], &t[p + 1]);
+    }
+    ms[PHASE_TOTAL] = diff_ms(&t[PHASE_CREATE], &t[PHASE_TOTAL]);
+
+    *file_bytes = 0;
+    FILE *fp = ok ? fopen(path, "rb") : NULL;
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        *file_bytes = ftell(fp);
+        fclose(fp);
+    }
+
+    maze_free(m);
+    bmp_free(img);
+    return ok;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* nearest-rank percentile of sorted samples */
+static double percentile(const double *sorted, int n, int pct) {
+    int rank = (pct * n + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void print_header(FILE *out, const struct Sweep *sw, unsigned threads) {
+    if (sw->csv) {
+        fprintf(out, "width,height,cell,wall,seed,algo,output");
+        for (int p = 0; p < PHASE_COUNT; ++p) {
+            fprintf(out, ",%s_median_ms,%s_p95_ms", PHASE_NAMES[p], PHASE_NAMES[p]);
+        }
+        fprintf(out, ",cells_per_s,pixels_per_s,save_mb_per_s,file_bytes,peak_rss_kb\n");
+    } else {
+        fprintf(out, "{\n  \"threads\": %u,\n  \"warmup\": %d,\n  \"trials\": %d,\n  \"results\": [",
+                threads, sw->warmup, sw->trials);
+    }
+}
+
+static void print_result(FILE *out, const struct Sweep *sw, const struct Config *c, bool first,
+                         double median[PHASE_COUNT], double p95[PHASE_COUNT], long file_bytes, long rss_kb) {
+    double cells = (double)c->width * c->height;
+    double pixels = cells * c->cell * c->cell;
+    double cells_per_s = cells / (median[PHASE_GENERATE] / 1e3);
+    double pixels_per_s = pixels / (median[PHASE_RENDER] / 1e3);
+    double mb_per_s = file_bytes / 1e6 / (median[PHASE_SAVE] / 1e3);
+    const char *algo = maze_algorithm_name(c->algo);
+
+    if (sw->csv) {
+        fprintf(out, "%zu,%zu,%d,%d,%llu,%s,%s", c->width, c->height, c->cell, c->wall, c->seed, algo, c->output->name);
+        for (int p = 0; p < PHASE_COUNT; ++p) {
+            fprintf(out, ",%.3f,%.3f", median[p], p95[p]);
+        }
+        fprintf(out, ",%.0f,%.0f,%.2f,%ld,%ld\n", cells_per_s, pixels_per_s, mb_per_s, file_bytes, rss_kb);
+    } else {
+        fprintf(out, "%s\n    {\"width\": %zu, \"height\": %zu, \"cell\": %d, \"wall\": %d, \"seed\": %llu, "
+                     "\"algo\": \"%s\", \"output\": \"%s\",\n",
+                first ? "" : ",", c->width, c->height, c->cell, c->wall, c->seed, algo, c->output->name);
+        for (int p = 0; p < PHASE_COUNT; ++p) {
+            fprintf(out, "     \"%s_ms\": {\"median\": %.3f, \"p95\": %.3f},\n", PHASE_NAMES[p], median[p], p95[p]);
+        }
+        fprintf(out, "     \"cells_per_s\": %.0f, \"pixels_per_s\": %.0f, \"save_mb_per_s\": %.2f, "
+                     "\"file_bytes\": %ld, \"peak_rss_kb\": %ld}",
+                cells_per_s, pixels_per_s, mb_per_s, file_bytes, rss_kb);
+    }
+    fflush(out);
+}
+
+/* warm up and time one configuration; false if any run failed */
+static bool bench_config(FILE *out, const struct Sweep *sw, const struct Config *c, ThreadPool *pool, bool first) {
+    char path[1024];
+    snprintf(path, sizeof path, "%s/maze_bench.%s", sw->dir, c->output->png ? "png" : "bmp");
+
+    double ms[PHASE_COUNT];
+    long file_bytes;
+    reset_peak_rss();
+    for (int i = 0; i < sw->warmup; ++i) {
+        if (!run_once(c, path, pool, ms, &file_bytes)) return false;
+    }
+
+    double *samples = malloc((size_t)sw->trials * PHASE_COUNT * sizeof(double));
+    if (!samples) return false;
+    for (int i = 0; i < sw->trials; ++i) {
+        if (!run_once(c, path, pool, ms, &file_bytes)) {
+            free(samples);
+            return false;
+        }
+        for (int p = 0; p < PHASE_COUNT; ++p) {
+            samples[p * sw->trials + i] = ms[p];
+        }
+    }
+    remove(path);
+
+    double median[PHASE_COUNT], p95[PHASE_COUNT];
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        double *s = samples + p * sw->trials;
+        qsort(s, sw->trials, sizeof(double), compare_double);
+        median[p] = percentile(s, sw->trials, 50);
+        p95[p] = percentile(s, sw->trials, 95);
+    }
+    free(samples);
+
+    print_result(out, sw, c, first, median, p95, file_bytes, peak_rss_kb());
+    fprintf(stderr, "%zux%zu cell %d wall %d seed %llu %s %s: %.3f ms\n", c->width, c->height, c->cell, c->wall,
+            c->seed, maze_algorithm_name(c->algo), c->output->name, median[PHASE_TOTAL]);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    struct Sweep sw = {
+        .widths = { 100, 1000 }, .heights = { 100, 1000 }, .n_dims = 2,
+        .cells = { 4, 10 }, .n_cells = 2,
+        .walls = { 1 }, .n_walls = 1,
+        .seeds = { 1 }, .n_seeds = 1,
+        .outputs = { &OUTPUTS[0], &OUTPUTS[4] }, .n_outputs = 2,
+        .warmup = 1, .trials = 5,
+        .csv = 0,
+        .dir = ".",
+    };
+    unsigned threads = 0;
+    const char *out_path = NULL;
+
+    /* every registered algorithm by default */
+    size_t n_generators;
+    const struct MazeGenerator *generators = maze_generators(&n_generators);
+    for (size_t i = 0; i < n_generators && i < MAX_LIST; ++i) {
+        sw.algos[sw.n_algos++] = generators[i].algorithm;
+    }
+
+    static struct option long_opts[] = {
+        {"dims",    required_argument, 0, 'd'},
+        {"cell",    required_argument, 0, 'c'},
+        {"wall",    required_argument, 0, 'w'},
+        {"seeds",   required_argument, 0,  1 },
+        {"algo",    required_argument, 0,  2 },
+        {"output",  required_argument, 0,  3 },
+        {"warmup",  required_argument, 0,  4 },
+        {"trials",  required_argument, 0,  5 },
+        {"threads", required_argument, 0,  6 },
+        {"format",  required_argument, 0,  7 },
+        {"out",     required_argument, 0, 'o'},
+        {"dir",     required_argument, 0,  8 },
+        {"help",    no_argument,       0, 'h'},
+        {0,0,0,0}
+    };
+
+    int opt, idx;
+    while ((opt = getopt_long(argc, argv, "d:c:w:o:h", long_opts, &idx)) != -1) {
+        switch (opt) {
+            case 'd': case 'c': case 'w': case 1: case 2: case 3:
+                if (!parse_sweep_option(&sw, opt, optarg)) {
+                    fprintf(stderr, "Error: invalid list '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 4:
+                sw.warmup = atoi(optarg);
+                break;
+            case 5:
+                sw.trials = atoi(optarg);
+                break;
+            case 6:
+                threads = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+            case 7:
+                if (strcmp(optarg, "json") != 0 && strcmp(optarg, "csv") != 0) {
+                    fprintf(stderr, "Error: --format must be json or csv\n");
+                    return EXIT_FAILURE;
+                }
+                sw.csv = strcmp(optarg, "csv") == 0;
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 8:
+                sw.dir = optarg;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (sw.warmup < 0 || sw.trials < 1) {
+        fprintf(stderr, "Error: --warmup must be at least 0 and --trials at least 1\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) { fprintf(stderr, "Error: cannot open '%s'\n", out_path); return EXIT_FAILURE; }
+    ThreadPool *pool = threadpool_create(threads);
+    if (!pool) { fprintf(stderr, "Error: threadpool_create() failed\n"); return EXIT_FAILURE; }
+
+    print_header(out, &sw, threadpool_size(pool));
+    int failed = 0;
+    bool first = true;
+    for (int d = 0; d < sw.n_dims; ++d)
+    for (int ci = 0; ci < sw.n_cells; ++ci)
+    for (int wi = 0; wi < sw.n_walls; ++wi)
+    for (int a = 0; a < sw.n_algos; ++a)
+    for (int o = 0; o < sw.n_outputs; ++o)
+    for (int s = 0; s < sw.n_seeds; ++s) {
+        struct Config c = { sw.widths[d], sw.heights[d], sw.cells[ci], sw.walls[wi], sw.seeds[s], sw.algos[a], sw.outputs[o] };
+        /* same limits as the generator's command line */
+        if (c.wall > c.cell / 2 || (c.width * c.cell > INT32_MAX) || (c.height * c.cell > INT32_MAX)) continue;
+        if (!bench_config(out, &sw, &c, pool, first)) {
+            fprintf(stderr, "Error: %zux%zu cell %d wall %d seed %llu %s %s failed\n", c.width, c.height, c.cell,
+                    c.wall, c.seed, maze_algorithm_name(c.algo), c.output->name);
+            failed++;
+            continue;
+        }
+        first = false;
+    }
+    if (!sw.csv) fprintf(out, "\n  ]\n}\n");
+
+    threadpool_free(pool);
+    if (out != stdout) fclose(out);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
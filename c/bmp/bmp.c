@@ -1,64 +1,222 @@
 #include "bmp.h"
+#include "../maze_stats/maze_stats.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
+#ifndef _WIN32
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap, msync, munmap
+#include <unistd.h>   // for ftruncate, close
+#endif
+
 typedef struct BmpFileHeader BmpFileHeader;
 typedef struct BmpInfoHeader BmpInfoHeader;
 typedef struct RGBTriple RGBTriple;
 typedef struct BmpImage BmpImage;
+typedef struct BmpWriter BmpWriter;
+typedef struct BmpFormat BmpFormat;
+typedef struct RGBQuad RGBQuad;
+
+#define HEADERS_SIZE (sizeof(BmpFileHeader) + sizeof(BmpInfoHeader))
 
+static const BmpFormat RGB24 = { 24, 0, {{0, 0, 0}} };
 
-int calculate_padding(int width) {
-    return (4 - (width * sizeof(RGBTriple)) % 4) % 4; // Calculate padding for each row
+// Bytes of pixel data in a row of the given depth, without the padding
+static size_t row_data_size(int width, int bitCount) {
+    return ((size_t)width * bitCount + 7) / 8;
 }
 
+// Bytes from one stored row to the next: rows are padded to 4 bytes
+static size_t row_size(int width, int bitCount) {
+    return ((size_t)width * bitCount + 31) / 32 * 4;
+}
 
-BmpImage *bmp_create(int width, int height) {
-int padding = calculate_padding(width);
-    int rowSize = width * sizeof(RGBTriple) + padding;
-    int pixelDataSize = rowSize * height;
-    int fileSize = sizeof(BmpFileHeader) + sizeof(BmpInfoHeader) + pixelDataSize;
+size_t bmp_file_size(int width, int height, const BmpFormat *fmt) {
+    if (!fmt) fmt = &RGB24;
+    return HEADERS_SIZE + fmt->n_colors * sizeof(RGBQuad) + row_size(width, fmt->bit_count) * (size_t)abs(height);
+}
+
+// Fill in the headers of an image; a negative height stores rows top-down.
+// The size fields of an image over BMP_MAX_FILE_SIZE are 0: it is never saved.
+static void init_headers(BmpFileHeader *fileHeader, BmpInfoHeader *infoHeader, int width, int height, const BmpFormat *fmt) {
+    size_t paletteSize = fmt->n_colors * sizeof(RGBQuad);
+    size_t pixelDataSize = row_size(width, fmt->bit_count) * (size_t)abs(height);
+    size_t fileSize = HEADERS_SIZE + paletteSize + pixelDataSize;
+    bool fits = fileSize <= BMP_MAX_FILE_SIZE;
+
+    fileHeader->bfType = 0x4D42;
+    fileHeader->bfSize = fits ? (uint32_t)fileSize : 0;
+    fileHeader->bfReserved1 = 0;
+    fileHeader->bfReserved2 = 0;
+    fileHeader->bfOffBits = HEADERS_SIZE + paletteSize;
+
+    infoHeader->biSize = sizeof(BmpInfoHeader);
+    infoHeader->biWidth = width;
+    infoHeader->biHeight = height;
+    infoHeader->biPlanes = 1;
+    infoHeader->biBitCount = fmt->bit_count;
+    infoHeader->biCompression = 0;
+    infoHeader->biSizeImage = fits ? (uint32_t)pixelDataSize : 0;
+    infoHeader->biXPelsPerMeter = 2835; // 72 DPI
+    infoHeader->biYPelsPerMeter = 2835;
+    infoHeader->biClrUsed = fmt->n_colors;
+    infoHeader->biClrImportant = 0;
+}
+
+// Write the color table of an indexed format
+static void write_palette(RGBQuad *palette, const BmpFormat *fmt) {
+    for (int i = 0; i < fmt->n_colors; i++) {
+        palette[i].rgbBlue = fmt->palette[i].rgbtBlue;
+        palette[i].rgbGreen = fmt->palette[i].rgbtGreen;
+        palette[i].rgbRed = fmt->palette[i].rgbtRed;
+        palette[i].rgbReserved = 0;
+    }
+}
+
+// Point pixels/stride/palette into image->file, which must hold the headers
+static void init_layout(BmpImage *image) {
+    int width = image->infoHeader.biWidth;
+    int height = abs(image->infoHeader.biHeight);
+    int bitCount = image->infoHeader.biBitCount;
+    ptrdiff_t rowSize = row_size(width, bitCount);
+    uint8_t *rows = image->file + image->fileHeader.bfOffBits;
+
+    image->padding = rowSize - row_data_size(width, bitCount);
+    image->palette = image->infoHeader.biClrUsed ? (RGBQuad *)(image->file + HEADERS_SIZE) : NULL;
+    if (image->infoHeader.biHeight < 0) {
+        image->pixels = (RGBTriple *)rows;
+        image->stride = rowSize;
+    } else {
+        // Bottom-up: the top row is the last one in the file
+        image->pixels = (RGBTriple *)(rows + (height - 1) * rowSize);
+        image->stride = -rowSize;
+    }
+}
+
+// Write fresh headers and palette into image->file, which must be large
+// enough, and lay the rows out behind them
+static void write_headers(BmpImage *image, int width, int height, const BmpFormat *fmt) {
+    init_headers(&image->fileHeader, &image->infoHeader, width, height, fmt);
+    memcpy(image->file, &image->fileHeader, sizeof(BmpFileHeader));
+    memcpy(image->file + sizeof(BmpFileHeader), &image->infoHeader, sizeof(BmpInfoHeader));
+    write_palette((RGBQuad *)(image->file + HEADERS_SIZE), fmt);
+    image->fileSize = bmp_file_size(width, height, fmt);
+    init_layout(image);
+}
 
-    BmpImage *image = malloc(sizeof(BmpImage));
+// Make an image whose file contents live in `file`, with fresh headers
+static BmpImage *wrap_file(uint8_t *file, int width, int height, const BmpFormat *fmt) {
+    BmpImage *image = calloc(1, sizeof(BmpImage));
     if (!image) return NULL;
 
-    image->fileHeader.bfType = 0x4D42;
-    image->fileHeader.bfSize = fileSize;
-    image->fileHeader.bfReserved1 = 0;
-    image->fileHeader.bfReserved2 = 0;
-    image->fileHeader.bfOffBits = sizeof(BmpFileHeader) + sizeof(BmpInfoHeader);
-
-    image->infoHeader.biSize = sizeof(BmpInfoHeader);
-    image->infoHeader.biWidth = width;
-    image->infoHeader.biHeight = height;
-    image->infoHeader.biPlanes = 1;
-    image->infoHeader.biBitCount = 24;
-    image->infoHeader.biCompression = 0;
-    image->infoHeader.biSizeImage = pixelDataSize;
-    image->infoHeader.biXPelsPerMeter = 2835; // 72 DPI
-    image->infoHeader.biYPelsPerMeter = 2835;
-    image->infoHeader.biClrUsed = 0;
-    image->infoHeader.biClrImportant = 0;
-
-    image->pixels = malloc(width * height * sizeof(RGBTriple));
-    if (!image->pixels) {
-        free(image);
+    image->file = file;
+    write_headers(image, width, height, fmt);
+    image->capacity = image->fileSize;
+    return image;
+}
+
+static bool valid_format(const BmpFormat *fmt) {
+    switch (fmt->bit_count) {
+        case 1: return fmt->n_colors >= 1 && fmt->n_colors <= 2;
+        case 8: return fmt->n_colors >= 1 && fmt->n_colors <= 256;
+        case 24: return fmt->n_colors == 0;
+        default: return false;
+    }
+}
+
+BmpImage *bmp_create(int width, int height) {
+    return bmp_create_format(width, height, &RGB24);
+}
+
+BmpImage *bmp_create_format(int width, int height, const BmpFormat *fmt) {
+    if (width <= 0 || height <= 0 || !fmt || !valid_format(fmt)) return NULL;
+
+    uint8_t *file = malloc(bmp_file_size(width, height, fmt));
+    if (!file) return NULL;
+
+    BmpImage *image = wrap_file(file, width, height, fmt);
+    if (!image) {
+        free(file);
         return NULL;
     }
 
-    // Initialize all pixels to white
-    for (int i = 0; i < width * height; i++) {
-        image->pixels[i].rgbtRed = 255;
-        image->pixels[i].rgbtGreen = 255;
-        image->pixels[i].rgbtBlue = 255;
+    // Initialize all pixels to white (index 0 when indexed) and the row
+    // padding to zero
+    size_t dataSize = row_data_size(width, fmt->bit_count);
+    for (int y = 0; y < height; y++) {
+        uint8_t *row = (uint8_t *)bmp_row(image, y);
+        memset(row, fmt->bit_count == 24 ? 0xFF : 0, dataSize);
+        memset(row + dataSize, 0, image->padding);
+    }
+
+    return image;
+}
+
+BmpImage *bmp_create_mapped(const char *filename, int width, int height, const BmpFormat *fmt) {
+    if (!fmt) fmt = &RGB24;
+    if (!filename || width <= 0 || height <= 0 || !valid_format(fmt)) return NULL;
+
+#ifdef _WIN32
+    // No mmap: an in-memory image that bmp_sync writes out in one go
+    BmpImage *image = bmp_create_format(width, height, fmt);
+    if (!image) return NULL;
+    image->path = malloc(strlen(filename) + 1);
+    if (!image->path) {
+        bmp_free(image);
+        return NULL;
     }
+    strcpy(image->path, filename);
+    return image;
+#else
+    size_t fileSize = bmp_file_size(width, height, fmt);
+    if (fileSize > BMP_MAX_FILE_SIZE) return NULL;
 
-    image->padding = padding;
+    // Size the file first; its pixels (zero, including the padding) are then
+    // only ever touched by the renderer through the mapping
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, (off_t)fileSize) != 0) {
+        close(fd);
+        return NULL;
+    }
+    void *file = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) return NULL;
 
+    BmpImage *image = wrap_file(file, width, height, fmt);
+    if (!image) {
+        munmap(file, fileSize);
+        return NULL;
+    }
+    image->mapped = true;
     return image;
+#endif
+}
+
+bool bmp_reshape(BmpImage *image, int width, int height, const BmpFormat *fmt) {
+    if (!fmt) fmt = &RGB24;
+    if (!image || image->mapped || image->path || width <= 0 || height <= 0 || !valid_format(fmt)) return false;
+
+    size_t fileSize = bmp_file_size(width, height, fmt);
+    if (fileSize > image->capacity) {
+        // The old pixels are not kept, so nothing is copied
+        uint8_t *file = malloc(fileSize);
+        if (!file) return false;
+        free(image->file);
+        image->file = file;
+        image->capacity = fileSize;
+    }
+    write_headers(image, width, height, fmt);
+
+    // Pixels keep whatever they held; the padding must still read as zero
+    size_t dataSize = row_data_size(width, fmt->bit_count);
+    for (int y = 0; y < height && image->padding; y++) {
+        memset((uint8_t *)bmp_row(image, y) + dataSize, 0, image->padding);
+    }
+    return true;
 }
 
 BmpImage *bmp_load(const char *filename) {
@@ -66,75 +224,133 @@ BmpImage *bmp_load(const char *filename) {
     if (!fp) return NULL;
 
     BmpFileHeader fileHeader;
-    fread(&fileHeader, sizeof(BmpFileHeader), 1, fp);
-    if (fileHeader.bfType != 0x4D42) { // 'BM' in little-endian
+    BmpInfoHeader infoHeader;
+    BmpFormat fmt;
+    if (fread(&fileHeader, sizeof(BmpFileHeader), 1, fp) != 1 ||
+        fread(&infoHeader, sizeof(BmpInfoHeader), 1, fp) != 1 ||
+        fileHeader.bfType != 0x4D42 || // 'BM' in little-endian
+        infoHeader.biCompression != 0 || infoHeader.biSize < sizeof(BmpInfoHeader) ||
+        infoHeader.biWidth <= 0 || infoHeader.biHeight == 0) {
         fclose(fp);
         return NULL;
     }
 
-    BmpInfoHeader infoHeader;
-    fread(&infoHeader, sizeof(BmpInfoHeader), 1, fp);
-    if (infoHeader.biBitCount != 24 || infoHeader.biCompression != 0) {
+    // Indexed images: the color table follows the info header, which may be
+    // one of the longer header versions
+    fmt.bit_count = infoHeader.biBitCount;
+    fmt.n_colors = infoHeader.biBitCount == 24 ? 0 : infoHeader.biClrUsed ? infoHeader.biClrUsed : 1u << infoHeader.biBitCount;
+    if (!valid_format(&fmt) || fseek(fp, sizeof(BmpFileHeader) + infoHeader.biSize, SEEK_SET) != 0) {
         fclose(fp);
         return NULL;
     }
+    for (int i = 0; i < fmt.n_colors; i++) {
+        RGBQuad q;
+        if (fread(&q, sizeof(RGBQuad), 1, fp) != 1) {
+            fclose(fp);
+            return NULL;
+        }
+        fmt.palette[i].rgbtBlue = q.rgbBlue;
+        fmt.palette[i].rgbtGreen = q.rgbGreen;
+        fmt.palette[i].rgbtRed = q.rgbRed;
+    }
 
     int width = infoHeader.biWidth;
     int height = abs(infoHeader.biHeight);
-    int padding = calculate_padding(width);
+    size_t pixelDataSize = row_size(width, fmt.bit_count) * (size_t)height;
 
-    RGBTriple *pixels = malloc(width * height * sizeof(RGBTriple));
-    if (!pixels) {
+    // The rows are kept exactly as stored; stride tells which way they run
+    BmpImage *image = NULL;
+    uint8_t *file = malloc(HEADERS_SIZE + fmt.n_colors * sizeof(RGBQuad) + pixelDataSize);
+    if (file) image = wrap_file(file, width, infoHeader.biHeight, &fmt);
+    if (!image || fseek(fp, fileHeader.bfOffBits, SEEK_SET) != 0 ||
+        fread(file + image->fileHeader.bfOffBits, 1, pixelDataSize, fp) != pixelDataSize) {
         fclose(fp);
+        free(file);
+        free(image);
         return NULL;
     }
-
-    fseek(fp, fileHeader.bfOffBits, SEEK_SET);
-    for (int y = height - 1; y >= 0; y--) {
-        fread(&pixels[y * width], sizeof(RGBTriple), width, fp);
-        fseek(fp, padding, SEEK_CUR);
-    }
-
     fclose(fp);
 
-    BmpImage *image = malloc(sizeof(BmpImage));
-    if (!image) {
-        free(pixels);
-        return NULL;
-    }
-
-    image->fileHeader = fileHeader;
-    image->infoHeader = infoHeader;
-    image->pixels = pixels;
-    image->padding = padding;
-
     return image;
 }
 
 bool bmp_save(const char *filename, const BmpImage *image) {
+    if (image->fileSize > BMP_MAX_FILE_SIZE) return false;
     FILE* fp = fopen(filename, "wb");
     if (!fp) return false;
 
-    fwrite(&image->fileHeader, sizeof(BmpFileHeader), 1, fp);
-    fwrite(&image->infoHeader, sizeof(BmpInfoHeader), 1, fp);
-    
-    int width = image->infoHeader.biWidth;
-    int height = abs(image->infoHeader.biHeight);
-    int padding = image->padding;
-    uint8_t pad[3] = {0, 0, 0};
-    
-    for (int y = height - 1; y >= 0; y--) {
-        fwrite(&image->pixels[y * width], sizeof(RGBTriple), width, fp);
-        fwrite(pad, 1, padding, fp);
+    // Headers and padded rows are already laid out as in the file
+    bool ok = fwrite(image->file, 1, image->fileSize, fp) == image->fileSize;
+    if (fclose(fp) != 0) ok = false;
+    if (ok) MAZE_STAT_ADD(bytes_written, image->fileSize);
+    return ok;
+}
+
+bool bmp_sync(BmpImage *image) {
+    if (!image) return false;
+
+#ifndef _WIN32
+    if (image->mapped) {
+        MAZE_STAT_ADD(bytes_written, image->fileSize);
+        return msync(image->file, image->fileSize, MS_SYNC) == 0;
     }
+#endif
+    return image->path && bmp_save(image->path, image);
+}
 
-    fclose(fp);
-    return true;
+// Seek to a 64-bit offset; a long is 32 bits on Windows
+static bool seek_to(FILE *fp, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool bmp_write_rect(const char *filename, const BmpImage *rect, int x, int y) {
+    if (!filename || !rect || x < 0 || y < 0) return false;
+    FILE *fp = fopen(filename, "r+b");
+    if (!fp) return false;
+
+    int rw = rect->infoHeader.biWidth, rh = abs(rect->infoHeader.biHeight);
+    int bitCount = rect->infoHeader.biBitCount;
+    BmpFileHeader fileHeader;
+    BmpInfoHeader infoHeader;
+    bool ok = fread(&fileHeader, sizeof(BmpFileHeader), 1, fp) == 1 &&
+              fread(&infoHeader, sizeof(BmpInfoHeader), 1, fp) == 1 &&
+              fileHeader.bfType == 0x4D42 && infoHeader.biCompression == 0 &&
+              infoHeader.biBitCount == bitCount && infoHeader.biWidth > 0 && infoHeader.biHeight != 0 &&
+              rw <= infoHeader.biWidth - x && rh <= abs(infoHeader.biHeight) - y;
+
+    // A 1-bit row is written in whole bytes, so it must not cut one in two
+    // except at the right edge, where the rest of the byte is padding
+    if (ok && bitCount == 1) {
+        ok = x % 8 == 0 && ((x + rw) % 8 == 0 || x + rw == infoHeader.biWidth);
+    }
+
+    size_t fileRow = row_size(infoHeader.biWidth, bitCount), bytes = row_data_size(rw, bitCount);
+    int height = abs(infoHeader.biHeight);
+    for (int r = 0; ok && r < rh; r++) {
+        int row = infoHeader.biHeight < 0 ? y + r : height - 1 - (y + r);
+        uint64_t offset = fileHeader.bfOffBits + (uint64_t)row * fileRow + (uint64_t)x * bitCount / 8;
+        ok = seek_to(fp, offset) && fwrite(bmp_row(rect, r), 1, bytes, fp) == bytes;
+    }
+    if (ok) MAZE_STAT_ADD(bytes_written, (uint64_t)rh * bytes);
+    if (fclose(fp) != 0) ok = false;
+    return ok;
 }
 
 void bmp_free(BmpImage *image) {
     if (image) {
-        free(image->pixels);
+#ifndef _WIN32
+        if (image->mapped) {
+            munmap(image->file, image->fileSize);
+        } else
+#endif
+        {
+            free(image->file);
+        }
+        free(image->path);
         free(image);
     }
 }
@@ -142,15 +358,70 @@ void bmp_free(BmpImage *image) {
 void bmp_set_pixel(BmpImage *image, int x, int y, RGBTriple color) {
     int width = image->infoHeader.biWidth;
     int height = abs(image->infoHeader.biHeight);
+    if (image->infoHeader.biBitCount != 24) return;
     if (x < 0 || x >= width || y < 0 || y >= height) return;
-    image->pixels[y * width + x] = color;
+    bmp_row(image, y)[x] = color;
 }
 
 RGBTriple* bmp_get_pixel(const BmpImage *image, int x, int y) {
     int width = image->infoHeader.biWidth;
     int height = abs(image->infoHeader.biHeight);
+    if (image->infoHeader.biBitCount != 24) return NULL;
     if (x < 0 || x >= width || y < 0 || y >= height) {
         return NULL;
     }
-    return &image->pixels[y * width + x];
-}
\ No newline at end of file
+    return &bmp_row(image, y)[x];
+}
+
+BmpWriter *bmp_writer_open(const char *filename, int width, int height, bool top_down, const BmpFormat *fmt) {
+    if (!fmt) fmt = &RGB24;
+    if (width <= 0 || height <= 0 || !valid_format(fmt) || bmp_file_size(width, height, fmt) > BMP_MAX_FILE_SIZE) return NULL;
+
+    BmpWriter *w = malloc(sizeof(BmpWriter));
+    if (!w) return NULL;
+
+    w->fp = fopen(filename, "wb");
+    if (!w->fp) {
+        free(w);
+        return NULL;
+    }
+    w->width = width;
+    w->height = height;
+    w->rows_written = 0;
+    w->row_bytes = row_data_size(width, fmt->bit_count);
+    w->padding = row_size(width, fmt->bit_count) - w->row_bytes;
+
+    BmpFileHeader fileHeader;
+    BmpInfoHeader infoHeader;
+    RGBQuad palette[256];
+    init_headers(&fileHeader, &infoHeader, width, top_down ? -height : height, fmt);
+    write_palette(palette, fmt);
+    w->ok = fwrite(&fileHeader, sizeof(BmpFileHeader), 1, w->fp) == 1 &&
+            fwrite(&infoHeader, sizeof(BmpInfoHeader), 1, w->fp) == 1 &&
+            fwrite(palette, sizeof(RGBQuad), fmt->n_colors, w->fp) == (size_t)fmt->n_colors;
+    MAZE_STAT_ADD(bytes_written, sizeof(BmpFileHeader) + sizeof(BmpInfoHeader) + fmt->n_colors * sizeof(RGBQuad));
+    return w;
+}
+
+bool bmp_writer_write_rows(BmpWriter *w, const void *rows, int n_rows, ptrdiff_t stride) {
+    if (!w || n_rows > w->height - w->rows_written) return false;
+
+    uint8_t pad[3] = {0, 0, 0};
+    const uint8_t *row = (const uint8_t *)rows;
+    for (int i = 0; i < n_rows && w->ok; i++, row += stride) {
+        w->ok = fwrite(row, 1, w->row_bytes, w->fp) == w->row_bytes &&
+                fwrite(pad, 1, w->padding, w->fp) == (size_t)w->padding;
+    }
+    w->rows_written += n_rows;
+    MAZE_STAT_ADD(bytes_written, (uint64_t)n_rows * (w->row_bytes + w->padding));
+    return w->ok;
+}
+
+bool bmp_writer_close(BmpWriter *w) {
+    if (!w) return false;
+
+    bool ok = w->ok && w->rows_written == w->height;
+    if (fclose(w->fp) != 0) ok = false;
+    free(w);
+    return ok;
+}
@@ -1,7 +1,10 @@
 #ifndef BMP_H
 #define BMP_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 struct BmpFileHeader {
     uint16_t bfType; // Magic number for BMP files (should be 'BM')
@@ -31,23 +34,81 @@ struct RGBTriple {
     uint8_t rgbtRed; // Red component (0-255)
 } __attribute__((packed)); // Ensure no padding between members
 
+struct RGBQuad {
+    uint8_t rgbBlue; // Blue component (0-255)
+    uint8_t rgbGreen; // Green component (0-255)
+    uint8_t rgbRed; // Red component (0-255)
+    uint8_t rgbReserved; // Must be 0
+} __attribute__((packed)); // One entry of the color table of an indexed image
+
+#define BMP_MAX_FILE_SIZE UINT32_MAX // Largest file the 32-bit size fields describe; bigger images live only in memory, e.g. for PNG output
+
+// Pixel format of a new image: 24-bit RGB, or 1/8-bit indices into a palette
+struct BmpFormat {
+    int bit_count; // 1, 8 or 24
+    int n_colors; // Palette entries (0 for 24-bit, at most 1 << bit_count)
+    struct RGBTriple palette[256];
+};
+
+// An image held exactly as its file: headers, then padded rows in file order.
+// Saving is a single write, and a mapped image is the output file itself.
 struct BmpImage {
     struct BmpFileHeader fileHeader; // BMP file header
     struct BmpInfoHeader infoHeader; // DIB header
-    struct RGBTriple *pixels; // Pixel data (bottom-up)
+    struct RGBTriple *pixels; // Top row of the image; see bmp_row (palette indices unless 24-bit)
+    ptrdiff_t stride; // Bytes from a row to the row below it (negative when stored bottom-up)
     int padding; // Row padding in bytes (0-3)
+    struct RGBQuad *palette; // Color table of an indexed image, NULL for 24-bit
+    uint8_t *file; // Whole file contents
+    size_t fileSize; // Bytes in file
+    size_t capacity; // Bytes allocated for file, at least fileSize
+    bool mapped; // file is a shared mapping of the output file
+    char *path; // Output file of a bmp_create_mapped image kept in memory
 };
 
+static inline struct RGBTriple *bmp_row(const struct BmpImage *image, int y) {
+    return (struct RGBTriple *)((uint8_t *)image->pixels + (ptrdiff_t)y * image->stride); // Pixel row y, counted from the top
+}
+
+// Writes a 24-bit BMP file row by row, so the image never has to be in memory
+struct BmpWriter {
+    FILE *fp;
+    int width; // Pixels per row
+    int height; // Rows in the image
+    int rows_written;
+    size_t row_bytes; // Pixel bytes per row, without the padding
+    int padding; // Row padding in bytes (0-3)
+    bool ok; // No write has failed so far
+};
+
+size_t bmp_file_size(int width, int height, const struct BmpFormat *fmt); // Bytes of headers, palette and padded rows of such an image (NULL fmt: 24-bit)
+
 struct BmpImage *bmp_create(int width, int height); // Create a new BMP image
 
-struct BmpImage *bmp_load(const char *filename); // Load a BMP file from disk
+struct BmpImage *bmp_create_format(int width, int height, const struct BmpFormat *fmt); // Create a new in-memory image of any supported depth and size; pixels start white, or index 0
+
+struct BmpImage *bmp_create_mapped(const char *filename, int width, int height, const struct BmpFormat *fmt); // Create the file at its final size and map it (NULL fmt: 24-bit); pixels start zero; NULL over BMP_MAX_FILE_SIZE
+
+bool bmp_reshape(struct BmpImage *image, int width, int height, const struct BmpFormat *fmt); // Give an in-memory image new dimensions and format, reusing its buffer when large enough (NULL fmt: 24-bit); pixel contents are undefined
+
+struct BmpImage *bmp_load(const char *filename); // Load an uncompressed 1-, 8- or 24-bit BMP file from disk
+
+bool bmp_save(const char *filename, const struct BmpImage *image); // Save a BMP file to disk; false for images over BMP_MAX_FILE_SIZE
+
+bool bmp_sync(struct BmpImage *image); // Flush a bmp_create_mapped image to its file
+
+bool bmp_write_rect(const char *filename, const struct BmpImage *rect, int x, int y); // Overwrite the pixels at (x, y) of an existing BMP file with rect, which has the file's depth (1-bit: x and the right edge on byte boundaries, or the right edge at the file's); only those rows are written
+
+void bmp_free(struct BmpImage *image); // Free the memory used by a BMP image (unmapping a mapped one)
+
+void bmp_set_pixel(struct BmpImage *image, int x, int y, struct RGBTriple color); // Set a pixel's color (24-bit images only)
 
-bool bmp_save(const char *filename, const struct BmpImage *image); // Save a BMP file to disk
+struct RGBTriple* bmp_get_pixel(const struct BmpImage *image, int x, int y); // Get a pixel's color (24-bit images only)
 
-void bmp_free(struct BmpImage *image); // Free the memory used by a BMP image
+struct BmpWriter *bmp_writer_open(const char *filename, int width, int height, bool top_down, const struct BmpFormat *fmt); // Write the headers of a width x height file (NULL fmt: 24-bit); rows follow bottom row first, or top row first if top_down; NULL over BMP_MAX_FILE_SIZE
 
-void bmp_set_pixel(struct BmpImage *image, int x, int y, struct RGBTriple color); // Set a pixel's color
+bool bmp_writer_write_rows(struct BmpWriter *w, const void *rows, int n_rows, ptrdiff_t stride); // Append n_rows rows in file order; row i starts stride * i bytes after rows (stride may be negative)
 
-struct RGBTriple* bmp_get_pixel(const struct BmpImage *image, int x, int y); // Get a pixel's color
+bool bmp_writer_close(struct BmpWriter *w); // Close the file; false if a write failed or rows are missing
 
 #endif // BMP_H
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,12 +7,24 @@
 #include <getopt.h>
 
 #include "maze_generator/maze_generator.h"
+#include "maze_render/maze_render.h"
+#include "maze_solver/maze_solver.h"
+#include "maze_stats/maze_stats.h"
 #include "bmp/bmp.h"
+#include "png/png.h"
+#include "rng/rng.h"
+#include "threadpool/threadpool.h"
 
 typedef struct Point   Point;
 typedef struct RGBTriple RGBTriple;
 typedef struct Maze    Maze;
+typedef struct MazeRegion MazeRegion;
+typedef struct MazeSolution MazeSolution;
+typedef struct MazeDistances MazeDistances;
 typedef struct BmpImage BmpImage;
+typedef struct BmpFormat BmpFormat;
+typedef struct Rng     Rng;
+typedef struct ThreadPool ThreadPool;
 
 /* clamp integer to [0,255] */
 static int clamp255(int v) {
@@ -32,7 +46,7 @@ static void usage(const char *prog) {
     fprintf(stderr,
         "Usage: %s [OPTIONS]\n\n"
         "Options:\n"
-        "  -f, --file <path>         Output BMP filename\n"
+        "  -f, --file <path>         Output filename, .bmp or .png\n"
         "  -d, --dims W H            Maze dimensions in cells (default: 20 20)\n"
         "  -c, --cell N              Cell size in pixels (default: 10)\n"
         "  -w, --wall N              Wall thickness in pixels (default: 1)\n"
@@ -42,7 +56,49 @@ static void usage(const char *prog) {
         "      --wc R G B            Wall color (default: 0 0 0)\n"
         "      --sc R G B            Start cell color (default: 0 255 0)\n"
         "      --ec R G B            End cell color (default: 255 0 0)\n"
+        "      --pc R G B            Solution path color (default: 255 0 0)\n"
         "      --seed SEED           RNG seed for reproducible output\n"
+        "      --algo NAME           Generation algorithm: dfs, eller, tiled, kruskal,\n"
+        "                            kruskal-mt, dfs-blocked, binary-tree,\n"
+        "                            sidewinder, growing-newest, growing-random,\n"
+        "                            growing-oldest, growing-mixed (default: dfs)\n"
+        "      --mix PERCENT         growing-mixed: share of steps that grow from\n"
+        "                            the newest cell, the rest from a random one\n"
+        "                            (default: 50)\n"
+        "      --threads N           Worker threads for generation and rendering,\n"
+        "                            0 = one per CPU (default: 0)\n"
+        "      --stream              Render straight to the file in bands instead of\n"
+        "                            building the whole image in memory\n"
+        "      --mmap                Render into the memory-mapped output file\n"
+        "      --bpp N               Bits per pixel: 24, 8 (palette) or\n"
+        "                            1 (2 colors, needs --no-markers) (default: 24)\n"
+        "      --no-markers          Do not color the start and end cells\n"
+        "      --save-maze <path>    Also save the generated maze as a .maze file\n"
+        "      --load-maze <path>    Render a .maze file instead of generating;\n"
+        "                            its dimensions, start and end are used\n"
+        "      --solve               Find the shortest path from start to end\n"
+        "      --draw-path           Solve and draw the path (not with --stream\n"
+        "                            or --bpp 1)\n"
+        "      --heatmap             Color cells by their distance from start\n"
+        "                            (not with --bpp 1)\n"
+        "      --batch <manifest>    Generate every maze listed in the manifest, one\n"
+        "                            per line: W H CELL SEED OUTPUT [key=value...]\n"
+        "                            with keys wall, start, end, bgc, wc, sc, ec,\n"
+        "                            algo, mix, bpp, markers; other options set\n"
+        "                            defaults\n"
+        "      --stats text|json     Print the hot-path counters at the end (needs\n"
+        "                            a build with -DMAZE_STATS)\n"
+        "      --tiles <name>        Write a deep-zoom tile pyramid, name.dzi and\n"
+        "                            name_files/, instead of one image; for mazes\n"
+        "                            too large for a single file\n"
+        "      --tile-size N         Tile size in pixels, even (default: 256)\n"
+        "      --preview WIDTH       Also write a preview at most WIDTH pixels wide\n"
+        "                            (walls and markers), next to the output as\n"
+        "                            <name>_preview.bmp/.png\n"
+        "      --reroll X Y W H      With --load-maze: carve the W x H cells at X Y\n"
+        "                            afresh from --seed, keeping the maze perfect,\n"
+        "                            and rewrite just that part of the .maze file\n"
+        "                            and of the -f BMP rendered from it\n"
         "  -v, --verbose             Print debug information\n"
         "  -h, --help                Show this help and exit\n"
         "      --version             Show version and exit\n",
@@ -50,6 +106,67 @@ static void usage(const char *prog) {
     );
 }
 
+/* Eller rows are rendered as they arrive; only the previous row's south
+   walls are kept, as the north walls of the next row */
+struct StreamRender {
+    BmpImage *img;
+    const struct MazeRenderConfig *cfg;
+    uint64_t *prev;
+};
+
+static bool render_streamed_row(const struct MazeRow *row, void *user) {
+    struct StreamRender *sr = user;
+    maze_render_row(row, row->y > 0 ? sr->prev : NULL, sr->cfg, sr->img);
+    memcpy(sr->prev, row->south, row->row_words * sizeof(uint64_t));
+    return true;
+}
+
+/* Eller rows go to the renderer, with --save-maze to a .maze file and
+   with --preview to the preview */
+struct RowTee {
+    MazeRowCallback render;
+    void *render_user;
+    struct MazeFileWriter *file;
+    struct MazePreview *preview;
+};
+
+static bool tee_row(const struct MazeRow *row, void *user) {
+    struct RowTee *tee = user;
+    if (!tee->render(row, tee->render_user)) return false;
+    if (tee->preview && !maze_preview_row(row, tee->preview)) return false;
+    return !tee->file || maze_file_writer_row(row, tee->file);
+}
+
+/* fill a grid with the chosen algorithm through the generator registry;
+   *fn names the generator for messages */
+static bool generate_grid(Maze *m, enum MazeAlgorithm algo, unsigned newest_percent, Rng *rng, ThreadPool *pool, const char **fn) {
+    const struct MazeGenerator *g = maze_generator_find(algo);
+    if (!g) g = maze_generator_find(MAZE_ALGO_DFS);
+    *fn = g->function;
+    struct MazeGenContext ctx = { m, rng, pool, newest_percent, NULL };
+    return maze_generator_run(g, &ctx);
+}
+
+/* the preview goes beside the output: "out.png" -> "out_preview.png", and
+   tiles "name" -> "name_preview.png" */
+static void preview_filename(char *buf, size_t size, const char *out, const char *tiles) {
+    if (tiles) {
+        snprintf(buf, size, "%s_preview.png", tiles);
+    } else {
+        size_t n = strlen(out) - 4; /* out ends in .bmp or .png */
+        snprintf(buf, size, "%.*s_preview%s", (int)n, out, out + n);
+    }
+}
+
+/* save a finished preview in the format its name asks for, and free it */
+static bool write_preview(BmpImage *img, const char *path, ThreadPool *pool) {
+    if (!img) return false;
+    bool ok = ends_with(path, ".png") ? png_save(path, img, pool) : bmp_save(path, img);
+    if (ok) printf("Preview %dx%d written to %s\n", (int)img->infoHeader.biWidth, abs(img->infoHeader.biHeight), path);
+    bmp_free(img);
+    return ok;
+}
+
 /* simple version string */
 static const char *VERSION = "1.0.0";
 
@@ -60,6 +177,245 @@ static double diff_ms(const struct timespec *start, const struct timespec *end)
     return sec * 1e3 + nsec / 1e6;
 }
 
+/* print the counters of the whole run, after the timings */
+static void print_stats(int json) {
+    struct MazeStats st;
+    maze_stats_collect(&st);
+    if (json) {
+        printf("{\"stack_pushes\": %llu, \"stack_pops\": %llu, \"stack_max_depth\": %llu, \"backtracks\": %llu, "
+               "\"rng_draws\": %llu, \"visited_probes\": %llu, \"pixels\": {",
+               (unsigned long long)st.stack_pushes, (unsigned long long)st.stack_pops,
+               (unsigned long long)st.stack_max_depth, (unsigned long long)st.backtracks,
+               (unsigned long long)st.rng_draws, (unsigned long long)st.visited_probes);
+        for (int c = 0; c < MAZE_STATS_COLORS; ++c) {
+            printf("%s\"%s\": %llu", c ? ", " : "", maze_stats_color_name((enum MazeStatsColor)c),
+                   (unsigned long long)st.pixels[c]);
+        }
+        printf("}, \"bytes_written\": %llu, \"write_syscalls\": %llu}\n",
+               (unsigned long long)st.bytes_written, (unsigned long long)st.write_syscalls);
+        return;
+    }
+    printf("Stack pushes / pops: %llu / %llu (max depth %llu)\n", (unsigned long long)st.stack_pushes,
+           (unsigned long long)st.stack_pops, (unsigned long long)st.stack_max_depth);
+    printf("Backtracks: %llu\n", (unsigned long long)st.backtracks);
+    printf("RNG draws: %llu\n", (unsigned long long)st.rng_draws);
+    printf("Probes of visited neighbors: %llu\n", (unsigned long long)st.visited_probes);
+    printf("Pixels written:");
+    for (int c = 0; c < MAZE_STATS_COLORS; ++c) {
+        printf(" %s %llu", maze_stats_color_name((enum MazeStatsColor)c), (unsigned long long)st.pixels[c]);
+    }
+    printf("\nBytes written: %llu in %llu write calls\n", (unsigned long long)st.bytes_written,
+           (unsigned long long)st.write_syscalls);
+}
+
+/* one maze of a --batch manifest */
+struct BatchJob {
+    size_t width, height;
+    int cell_size, wall_th;
+    Point start, end;
+    RGBTriple bgc, wc, sc, ec;
+    unsigned long long seed;
+    enum MazeAlgorithm algo;
+    unsigned mix; /* growing-mixed newest percent */
+    int bpp;
+    int markers;
+    char *out;
+    int line; /* manifest line, for messages */
+};
+
+/* a worker keeps its maze and image between jobs and only grows them */
+struct BatchWorker {
+    Maze *m;
+    BmpImage *img;
+    size_t done, failed;
+};
+
+struct Batch {
+    struct BatchJob *jobs;
+    size_t n_jobs;
+    struct BatchWorker *workers;
+};
+
+/* parse "R,G,B" or "X,Y" manifest values */
+static int parse_color(const char *v, RGBTriple *c) {
+    int r, g, b;
+    if (sscanf(v, "%d,%d,%d", &r, &g, &b) != 3) return 0;
+    c->rgbtRed = clamp255(r);
+    c->rgbtGreen = clamp255(g);
+    c->rgbtBlue = clamp255(b);
+    return 1;
+}
+
+static int parse_point(const char *v, Point *p) {
+    return sscanf(v, "%" SCNd64 ",%" SCNd64, &p->x, &p->y) == 2;
+}
+
+/* fill in one job from a manifest line; fields not on the line keep the
+   values of `job`, except that end defaults to the far corner */
+static int parse_batch_line(char *line, struct BatchJob *job) {
+    char out[256];
+    int used = 0;
+    if (sscanf(line, "%zu %zu %d %llu %255s%n", &job->width, &job->height, &job->cell_size, &job->seed, out, &used) != 5) {
+        return 0;
+    }
+    job->end.x = (int64_t)job->width - 1;
+    job->end.y = (int64_t)job->height - 1;
+
+    for (char *tok = strtok(line + used, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+        char *eq = strchr(tok, '=');
+        if (!eq) return 0;
+        *eq = '\0';
+        const char *v = eq + 1;
+        int ok;
+        if      (!strcmp(tok, "wall"))    ok = sscanf(v, "%d", &job->wall_th) == 1;
+        else if (!strcmp(tok, "start"))   ok = parse_point(v, &job->start);
+        else if (!strcmp(tok, "end"))     ok = parse_point(v, &job->end);
+        else if (!strcmp(tok, "bgc"))     ok = parse_color(v, &job->bgc);
+        else if (!strcmp(tok, "wc"))      ok = parse_color(v, &job->wc);
+        else if (!strcmp(tok, "sc"))      ok = parse_color(v, &job->sc);
+        else if (!strcmp(tok, "ec"))      ok = parse_color(v, &job->ec);
+        else if (!strcmp(tok, "algo"))    ok = maze_algorithm_from_name(v, &job->algo);
+        else if (!strcmp(tok, "mix"))     ok = sscanf(v, "%u", &job->mix) == 1 && job->mix <= 100;
+        else if (!strcmp(tok, "bpp"))     ok = sscanf(v, "%d", &job->bpp) == 1;
+        else if (!strcmp(tok, "markers")) ok = sscanf(v, "%d", &job->markers) == 1;
+        else ok = 0;
+        if (!ok) return 0;
+    }
+
+    /* same checks as a single maze */
+    if (job->width == 0 || job->height == 0 ||
+        job->cell_size <= 2 || job->wall_th < 1 || job->wall_th > job->cell_size/2 ||
+        job->width > (size_t)INT_MAX / (size_t)job->cell_size || job->height > (size_t)INT_MAX / (size_t)job->cell_size ||
+        job->start.x < 0 || job->start.x >= (int64_t)job->width ||
+        job->start.y < 0 || job->start.y >= (int64_t)job->height ||
+        job->end.x   < 0 || job->end.x   >= (int64_t)job->width ||
+        job->end.y   < 0 || job->end.y   >= (int64_t)job->height ||
+        (job->bpp != 24 && job->bpp != 8 && job->bpp != 1) || (job->bpp == 1 && job->markers) ||
+        (!ends_with(out, ".bmp") && !ends_with(out, ".png")))
+    {
+        return 0;
+    }
+
+    job->out = malloc(strlen(out) + 1);
+    if (!job->out) return 0;
+    strcpy(job->out, out);
+    return 1;
+}
+
+/* read every job of a manifest; blank lines and lines starting with '#'
+   are skipped */
+static struct BatchJob *read_manifest(const char *path, const struct BatchJob *defaults, size_t *n_jobs) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: cannot open manifest '%s'\n", path);
+        return NULL;
+    }
+
+    struct BatchJob *jobs = NULL;
+    size_t n = 0, capacity = 0;
+    char line[1024];
+    int line_no = 0, ok = 1;
+    while (ok && fgets(line, sizeof line, fp)) {
+        line_no++;
+        char *p = line + strspn(line, " \t\r\n");
+        if (*p == '\0' || *p == '#') continue;
+        if (n == capacity) {
+            capacity = capacity ? 2 * capacity : 256;
+            struct BatchJob *grown = realloc(jobs, capacity * sizeof *jobs);
+            if (!grown) { ok = 0; break; }
+            jobs = grown;
+        }
+        jobs[n] = *defaults;
+        jobs[n].line = line_no;
+        if (!parse_batch_line(p, &jobs[n])) {
+            fprintf(stderr, "Error: %s:%d: invalid maze spec\n", path, line_no);
+            ok = 0;
+            break;
+        }
+        n++;
+    }
+    fclose(fp);
+
+    if (!ok) {
+        for (size_t i = 0; i < n; ++i) free(jobs[i].out);
+        free(jobs);
+        return NULL;
+    }
+    *n_jobs = n;
+    return jobs;
+}
+
+/* generate, render and save one job on the worker's reused maze and image;
+   a job runs on one thread, the pool's parallelism is across jobs. Workers
+   call png_save concurrently, which builds its shared tables only once */
+static void run_batch_job(void *ctx, size_t task, unsigned worker) {
+    struct Batch *b = ctx;
+    const struct BatchJob *job = &b->jobs[task];
+    struct BatchWorker *w = &b->workers[worker];
+
+    bool ok = w->m ? maze_reshape(w->m, job->width, job->height, job->cell_size, job->start, job->end, job->wall_th)
+                   : (w->m = maze_create(job->width, job->height, job->cell_size, job->start, job->end, job->wall_th)) != NULL;
+
+    Rng rng;
+    rng_seed(&rng, job->seed);
+    const char *fn;
+    ok = ok && generate_grid(w->m, job->algo, job->mix, &rng, NULL, &fn);
+
+    struct MazeRenderConfig cfg = { job->cell_size, job->wall_th, job->bgc, job->wc, job->sc, job->ec,
+                                    MAZE_PATH_COLOR, job->bpp, job->markers, NULL };
+    BmpFormat fmt;
+    maze_render_format(&cfg, &fmt);
+    int pw = (int)(job->width * job->cell_size), ph = (int)(job->height * job->cell_size);
+    ok = ok && (w->img ? bmp_reshape(w->img, pw, ph, &fmt) : (w->img = bmp_create_format(pw, ph, &fmt)) != NULL);
+    if (ok) maze_render_to_bmp(w->m, w->img, &cfg, NULL);
+    ok = ok && (ends_with(job->out, ".png") ? png_save(job->out, w->img, NULL) : bmp_save(job->out, w->img));
+
+    if (ok) {
+        w->done++;
+    } else {
+        w->failed++;
+        fprintf(stderr, "Error: manifest line %d (%s) failed\n", job->line, job->out);
+    }
+}
+
+/* --batch: all jobs on one work-stealing pool, then the throughput */
+static int run_batch(const char *manifest, const struct BatchJob *defaults, unsigned threads) {
+    struct Batch b = { NULL, 0, NULL };
+    b.jobs = read_manifest(manifest, defaults, &b.n_jobs);
+    if (!b.jobs) return 0;
+
+    ThreadPool *pool = threadpool_create(threads);
+    b.workers = pool ? calloc(threadpool_size(pool), sizeof *b.workers) : NULL;
+    if (!b.workers) {
+        fprintf(stderr, "Error: threadpool_create() failed\n");
+        threadpool_free(pool);
+        for (size_t i = 0; i < b.n_jobs; ++i) free(b.jobs[i].out);
+        free(b.jobs);
+        return 0;
+    }
+
+    struct timespec s, e;
+    clock_gettime(CLOCK_MONOTONIC, &s);
+    threadpool_run_stealing(pool, b.n_jobs, run_batch_job, &b);
+    clock_gettime(CLOCK_MONOTONIC, &e);
+
+    size_t done = 0, failed = 0;
+    for (unsigned w = 0; w < threadpool_size(pool); ++w) {
+        done += b.workers[w].done;
+        failed += b.workers[w].failed;
+        maze_free(b.workers[w].m);
+        bmp_free(b.workers[w].img);
+    }
+    printf("Batch: %zu mazes in %.3f ms on %u threads (%.1f mazes/s), %zu failed\n",
+           done, diff_ms(&s, &e), threadpool_size(pool), done / (diff_ms(&s, &e) / 1e3), failed);
+
+    threadpool_free(pool);
+    for (size_t i = 0; i < b.n_jobs; ++i) free(b.jobs[i].out);
+    free(b.jobs);
+    free(b.workers);
+    return failed == 0;
+}
+
 int main(int argc, char *argv[]) {
     /* defaults */
     size_t     width     = 20, height    = 20;
@@ -67,15 +423,36 @@ int main(int argc, char *argv[]) {
     int        wall_th   = 1;
     Point      start     = {0, 0};
     Point      endp      = {0, 0};
+    int        end_set   = 0; /* otherwise the end is the far corner */
 
     RGBTriple  bgc = {255,255,255},
                wc  = {0,0,0},
                sc  = {0,255,0},
-               ec  = {255,0,0};
+               ec  = {255,0,0},
+               pc  = {0,0,255};
 
-    unsigned long seed = (unsigned long) time(NULL);
+    unsigned long long seed = (unsigned long long) time(NULL);
+    enum MazeAlgorithm algo = MAZE_ALGO_DFS;
+    unsigned   mix = MAZE_GROW_NEWEST_PERCENT;
+    unsigned   threads = 0;
+    int stream = 0;
+    int mapped = 0;
+    int bpp = 24;
+    int markers = 1;
+    int solve = 0;
+    int draw_path = 0;
+    int heatmap = 0;
+    const char *batch = NULL;
+    int stats = -1; /* -1 off, 0 text, 1 json */
+    const char *tiles = NULL;
+    unsigned tile_size = 256;
+    size_t preview_width = 0;
+    MazeRegion reroll = { 0, 0, 0, 0 };
+    int rerolling = 0;
     int verbose = 0;
     char out_filename[256] = {0};
+    const char *save_maze = NULL;
+    const char *load_maze = NULL;
 
     /* long options table */
     static struct option long_opts[] = {
@@ -93,6 +470,25 @@ int main(int argc, char *argv[]) {
         {"verbose", no_argument,       0, 'v'},
         {"help",    no_argument,       0, 'h'},
         {"version", no_argument,       0,  6 },
+        {"algo",    required_argument, 0,  7 },
+        {"threads", required_argument, 0,  8 },
+        {"stream",  no_argument,       0,  9 },
+        {"mmap",    no_argument,       0, 10 },
+        {"bpp",     required_argument, 0, 11 },
+        {"no-markers", no_argument,    0, 12 },
+        {"save-maze", required_argument, 0, 13 },
+        {"load-maze", required_argument, 0, 14 },
+        {"pc",      required_argument, 0, 15 },
+        {"solve",   no_argument,       0, 16 },
+        {"draw-path", no_argument,     0, 17 },
+        {"heatmap", no_argument,       0, 18 },
+        {"batch",   required_argument, 0, 19 },
+        {"stats",   required_argument, 0, 20 },
+        {"tiles",   required_argument, 0, 21 },
+        {"tile-size", required_argument, 0, 22 },
+        {"preview", required_argument, 0, 23 },
+        {"reroll",  required_argument, 0, 24 },
+        {"mix",     required_argument, 0, 25 },
         {0,0,0,0}
     };
 
@@ -112,14 +508,15 @@ int main(int argc, char *argv[]) {
             case 'w': wall_th   = atoi(optarg); break;
             case 's':
                 if (optind < argc) {
-                    start.x = atoi(optarg);
-                    start.y = atoi(argv[optind++]);
+                    start.x = strtoll(optarg, NULL, 10);
+                    start.y = strtoll(argv[optind++], NULL, 10);
                 }
                 break;
             case 'e':
                 if (optind < argc) {
-                    endp.x = atoi(optarg);
-                    endp.y = atoi(argv[optind++]);
+                    endp.x = strtoll(optarg, NULL, 10);
+                    endp.y = strtoll(argv[optind++], NULL, 10);
+                    end_set = 1;
                 }
                 break;
             case 1:  /* --bgc */
@@ -158,8 +555,94 @@ int main(int argc, char *argv[]) {
                 ec.rgbtGreen = clamp255(atoi(argv[optind++]));
                 ec.rgbtBlue  = clamp255(atoi(argv[optind++]));
                 break;
+            case 15: /* --pc */
+                if (optind + 1 >= argc) {
+                    fprintf(stderr, "Error: --pc requires three arguments\n");
+                    return EXIT_FAILURE;
+                }
+                pc.rgbtRed   = clamp255(atoi(optarg));
+                pc.rgbtGreen = clamp255(atoi(argv[optind++]));
+                pc.rgbtBlue  = clamp255(atoi(argv[optind++]));
+                break;
             case 5:
-                seed = strtoul(optarg, NULL, 10);
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 7:
+                if (!maze_algorithm_from_name(optarg, &algo)) {
+                    fprintf(stderr, "Error: unknown algorithm '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 8:
+                threads = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+            case 9:
+                stream = 1;
+                break;
+            case 10:
+                mapped = 1;
+                break;
+            case 11:
+                bpp = atoi(optarg);
+                break;
+            case 12:
+                markers = 0;
+                break;
+            case 13:
+                save_maze = optarg;
+                break;
+            case 14:
+                load_maze = optarg;
+                break;
+            case 16:
+                solve = 1;
+                break;
+            case 17:
+                solve = draw_path = 1;
+                break;
+            case 18:
+                heatmap = 1;
+                break;
+            case 19:
+                batch = optarg;
+                break;
+            case 20:
+                if (strcmp(optarg, "text") != 0 && strcmp(optarg, "json") != 0) {
+                    fprintf(stderr, "Error: --stats must be text or json\n");
+                    return EXIT_FAILURE;
+                }
+                stats = strcmp(optarg, "json") == 0;
+                break;
+            case 21:
+                tiles = optarg;
+                break;
+            case 22:
+                tile_size = (unsigned)strtoul(optarg, NULL, 10);
+                break;
+            case 23:
+                preview_width = strtoul(optarg, NULL, 10);
+                if (preview_width == 0 || preview_width > 65536) {
+                    fprintf(stderr, "Error: --preview must be between 1 and 65536\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 24: /* --reroll */
+                if (optind + 2 >= argc) {
+                    fprintf(stderr, "Error: --reroll requires four arguments\n");
+                    return EXIT_FAILURE;
+                }
+                reroll.x0 = strtoul(optarg, NULL, 10);
+                reroll.y0 = strtoul(argv[optind++], NULL, 10);
+                reroll.x1 = reroll.x0 + strtoul(argv[optind++], NULL, 10);
+                reroll.y1 = reroll.y0 + strtoul(argv[optind++], NULL, 10);
+                rerolling = 1;
+                break;
+            case 25:
+                mix = (unsigned)strtoul(optarg, NULL, 10);
+                if (mix > 100) {
+                    fprintf(stderr, "Error: --mix must be between 0 and 100\n");
+                    return EXIT_FAILURE;
+                }
                 break;
             case 'v':
                 verbose = 1;
@@ -176,6 +659,65 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (!end_set) {
+        endp.x = (int64_t)width - 1;
+        endp.y = (int64_t)height - 1;
+    }
+
+    if (stats >= 0 && !maze_stats_enabled()) {
+        fprintf(stderr, "Error: --stats needs a build with -DMAZE_STATS\n");
+        return EXIT_FAILURE;
+    }
+    maze_stats_reset();
+
+    /* batch: the command line only supplies defaults for the manifest */
+    if (batch) {
+        struct BatchJob defaults = { width, height, cell_size, wall_th, start, endp, bgc, wc, sc, ec,
+                                     seed, algo, mix, bpp, markers, NULL, 0 };
+        bool ok = run_batch(batch, &defaults, threads);
+        if (stats >= 0) print_stats(stats);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    /* start total timer */
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    /* 0) a loaded maze replaces generation and brings its own dimensions,
+       start, end and provenance */
+    Maze *m = NULL;
+    struct MazeFileInfo info = { seed, algo };
+    if (load_maze) {
+        struct timespec s, e;
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        m = maze_load(load_maze, cell_size, wall_th, &info);
+        if (!m) { fprintf(stderr, "Error: maze_load() failed for '%s'\n", load_maze); return EXIT_FAILURE; }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("maze_load() completed in %.3f ms\n", diff_ms(&s, &e));
+        width = m->width;
+        height = m->height;
+        start = m->start;
+        endp = m->end;
+        if (!rerolling) seed = info.seed; /* a re-roll draws from --seed */
+        algo = info.algorithm;
+    }
+
+    /* a re-roll patches files that already exist */
+    if (rerolling && (!load_maze || out_filename[0] == '\0' || !ends_with(out_filename, ".bmp") ||
+                      stream || mapped || tiles || save_maze || solve || heatmap || preview_width)) {
+        fprintf(stderr, "Error: --reroll needs --load-maze and -f naming the BMP rendered from it, and none\n"
+                        "       of --stream, --mmap, --tiles, --save-maze, --solve, --draw-path,\n"
+                        "       --heatmap or --preview\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+    if (rerolling && (reroll.x0 >= reroll.x1 || reroll.y0 >= reroll.y1 ||
+                      reroll.x1 > width || reroll.y1 > height)) {
+        fprintf(stderr, "Error: --reroll region is empty or outside the %zux%zu maze\n", width, height);
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+
     /* default filename if none provided */
     if (out_filename[0] == '\0') {
         time_t now = time(NULL);
@@ -184,31 +726,82 @@ int main(int argc, char *argv[]) {
                  width, height, (long)now);
     }
 
-    /* validate extension */
-    if (!ends_with(out_filename, ".bmp")) {
-        fprintf(stderr, "Error: output filename must end in .bmp\n");
+    /* validate extension; tiles are always PNG */
+    int png = ends_with(out_filename, ".png");
+    if (!tiles && !png && !ends_with(out_filename, ".bmp")) {
+        fprintf(stderr, "Error: output filename must end in .bmp or .png\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+    if (png && (stream || mapped)) {
+        fprintf(stderr, "Error: --stream and --mmap write BMP files only\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+
+    if (bpp != 24 && bpp != 8 && bpp != 1) {
+        fprintf(stderr, "Error: --bpp must be 24, 8 or 1\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+    if (bpp == 1 && markers) {
+        fprintf(stderr, "Error: --bpp 1 has only two colors and needs --no-markers\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+
+    if (draw_path && (stream || bpp == 1)) {
+        fprintf(stderr, "Error: --draw-path needs an in-memory render with 8 or 24 bpp\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+
+    if (heatmap && bpp == 1) {
+        fprintf(stderr, "Error: --heatmap needs 8 or 24 bpp\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+
+    if (tiles && (stream || mapped || draw_path || heatmap || bpp != 24)) {
+        fprintf(stderr, "Error: --tiles writes 24-bit tiles of the plain maze; drop --stream, --mmap,\n"
+                        "       --draw-path, --heatmap and --bpp\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+    if (tiles && (tile_size < 16 || tile_size > 8192 || tile_size % 2)) {
+        fprintf(stderr, "Error: --tile-size must be even and between 16 and 8192\n");
+        maze_free(m);
         return EXIT_FAILURE;
     }
 
     /* sanity checks */
     if (width == 0 || height == 0 ||
         cell_size <= 2 || wall_th < 1 || wall_th > cell_size/2 ||
-        start.x < 0 || start.x >= (int)width ||
-        start.y < 0 || start.y >= (int)height ||
-        endp.x  < 0 || endp.x  >= (int)width ||
-        endp.y  < 0 || endp.y  >= (int)height)
+        start.x < 0 || start.x >= (int64_t)width ||
+        start.y < 0 || start.y >= (int64_t)height ||
+        endp.x  < 0 || endp.x  >= (int64_t)width ||
+        endp.y  < 0 || endp.y  >= (int64_t)height)
     {
         fprintf(stderr, "Error: invalid parameters\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+
+    /* a single image is limited to 2^31-1 pixels a side; tiles are not */
+    if (!tiles && (width > (size_t)INT_MAX / (size_t)cell_size || height > (size_t)INT_MAX / (size_t)cell_size)) {
+        fprintf(stderr, "Error: a %zux%zu maze of %d-pixel cells is too large for one image; use --tiles\n",
+                width, height, cell_size);
+        maze_free(m);
         return EXIT_FAILURE;
     }
 
     if (verbose) {
         fprintf(stderr,
-            "DEBUG: dims=%zux%zu, cell_size=%d, wall_thick=%d, seed=%lu\n"
-            "       start=(%d,%d), end=(%d,%d)\n"
+            "DEBUG: dims=%zux%zu, cell_size=%d, wall_thick=%d, seed=%llu, algo=%s, threads=%u\n"
+            "       start=(%" PRId64 ",%" PRId64 "), end=(%" PRId64 ",%" PRId64 ")\n"
             "       bgc=(%u,%u,%u), wc=(%u,%u,%u), sc=(%u,%u,%u), ec=(%u,%u,%u)\n"
             "       outfile=%s\n",
-            width, height, cell_size, wall_th, seed,
+            width, height, cell_size, wall_th, seed, maze_algorithm_name(algo), threads,
             start.x, start.y, endp.x, endp.y,
             bgc.rgbtRed,bgc.rgbtGreen,bgc.rgbtBlue,
             wc.rgbtRed,wc.rgbtGreen,wc.rgbtBlue,
@@ -218,28 +811,216 @@ int main(int argc, char *argv[]) {
         );
     }
 
-    /* start total timer */
-    struct timespec t0, t1;
-    clock_gettime(CLOCK_MONOTONIC, &t0);
+    /* render settings, shared read-only by the render threads */
+    struct MazeRenderConfig cfg = { cell_size, wall_th, bgc, wc, sc, ec, pc, bpp, markers, NULL };
+    BmpFormat fmt;
+    maze_render_format(&cfg, &fmt);
 
-    /* 1) create maze */
-    Maze *m;
-    {
+    /* a BMP file stores its size in 32 bits */
+    if (!tiles && !png && bmp_file_size((int)(width * cell_size), (int)(height * cell_size), &fmt) > BMP_MAX_FILE_SIZE) {
+        fprintf(stderr, "Error: the image is over the 4 GiB a BMP file can hold; write a .png or use --tiles\n");
+        maze_free(m);
+        return EXIT_FAILURE;
+    }
+
+    Rng rng;
+    rng_seed(&rng, seed);
+
+    /* re-roll: only the region's cells change, so only their words of the
+       .maze file and their pixels of the BMP are rewritten */
+    if (rerolling) {
+        struct timespec s, e;
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        const char *fn = "maze_regenerate_region()";
+        bool ok = maze_regenerate_region(m, &rng, &reroll);
+        if (ok) {
+            fn = "maze_render_region_to_file()";
+            ok = maze_render_region_to_file(m, out_filename, &cfg, &reroll);
+        }
+        if (ok) {
+            fn = "maze_save_region()";
+            ok = maze_save_region(m, load_maze, &reroll);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        maze_free(m);
+        if (!ok) {
+            fprintf(stderr, "Error: %s failed\n", fn);
+            return EXIT_FAILURE;
+        }
+        printf("Re-rolled %zux%zu cells at (%zu,%zu) in %.3f ms\n", reroll.x1 - reroll.x0, reroll.y1 - reroll.y0,
+               reroll.x0, reroll.y0, diff_ms(&s, &e));
+        if (stats >= 0) print_stats(stats);
+        return EXIT_SUCCESS;
+    }
+
+    ThreadPool *pool = threadpool_create(threads);
+    if (!pool) { fprintf(stderr, "Error: threadpool_create() failed\n"); maze_free(m); return EXIT_FAILURE; }
+
+    /* 1) create maze (Eller's algorithm streams rows and needs no grid
+          unless it is solved) */
+    if (!m && (algo != MAZE_ALGO_ELLER || solve || heatmap)) {
         struct timespec s, e;
         clock_gettime(CLOCK_MONOTONIC, &s);
         m = maze_create(width, height, cell_size, start, endp, wall_th);
-        if (!m) { fprintf(stderr, "Error: maze_create() failed\n"); return EXIT_FAILURE; }
+        if (!m) { fprintf(stderr, "Error: maze_create() failed\n"); threadpool_free(pool); return EXIT_FAILURE; }
         clock_gettime(CLOCK_MONOTONIC, &e);
         printf("maze_create() completed in %.3f ms\n", diff_ms(&s, &e));
     }
 
-    /* 2) generate DFS maze */
-    {
+    /* 2) generate maze (without a grid, Eller's algorithm generates while
+          rendering) */
+    if (!load_maze && m) {
         struct timespec s, e;
+        const char *fn;
         clock_gettime(CLOCK_MONOTONIC, &s);
-        maze_generate_dfs(m);
+        bool ok = generate_grid(m, algo, mix, &rng, pool, &fn);
         clock_gettime(CLOCK_MONOTONIC, &e);
-        printf("maze_generate_dfs() completed in %.3f ms\n", diff_ms(&s, &e));
+        if (!ok) {
+            fprintf(stderr, "Error: %s failed\n", fn);
+            threadpool_free(pool);
+            maze_free(m);
+            return EXIT_FAILURE;
+        }
+        printf("%s completed in %.3f ms (%.2f Mcells/s)\n", fn, diff_ms(&s, &e),
+               (double)width * height / (diff_ms(&s, &e) * 1e3));
+    }
+
+    /* 2b) save the grid; Eller rows are saved as they are generated */
+    struct MazeFileWriter *maze_out = NULL;
+    if (save_maze) {
+        struct timespec s, e;
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        const char *fn = m ? "maze_save()" : "maze_file_writer_open()";
+        bool ok = m ? maze_save(m, save_maze, &info)
+                    : (maze_out = maze_file_writer_open(save_maze, width, height, start, endp, &info)) != NULL;
+        if (!ok) {
+            fprintf(stderr, "Error: %s failed for '%s'\n", fn, save_maze);
+            maze_free(m);
+            threadpool_free(pool);
+            return EXIT_FAILURE;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        if (m) printf("%s completed in %.3f ms\n", fn, diff_ms(&s, &e));
+    }
+
+    /* 2c) solve */
+    MazeSolution solution = { 0 };
+    if (solve) {
+        struct timespec s, e;
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        if (!maze_solve(m, &solution)) {
+            fprintf(stderr, "Error: maze_solve() failed\n");
+            maze_file_writer_close(maze_out);
+            maze_free(m);
+            threadpool_free(pool);
+            return EXIT_FAILURE;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("maze_solve() completed in %.3f ms\n", diff_ms(&s, &e));
+        if (solution.length) {
+            printf("Path length: %zu cells (%zu cells explored)\n", solution.length, solution.explored);
+        } else {
+            printf("End is unreachable from start (%zu cells explored)\n", solution.explored);
+        }
+    }
+
+    /* 2d) distance field for the heatmap */
+    MazeDistances distances = { 0 };
+    if (heatmap) {
+        struct timespec s, e;
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        if (!maze_distances(m, pool, &distances)) {
+            fprintf(stderr, "Error: maze_distances() failed\n");
+            maze_file_writer_close(maze_out);
+            maze_solution_free(&solution);
+            maze_free(m);
+            threadpool_free(pool);
+            return EXIT_FAILURE;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("maze_distances() completed in %.3f ms (max distance %u, %zu cells reached)\n",
+               diff_ms(&s, &e), distances.max, distances.reached);
+        cfg.heatmap = &distances;
+        maze_render_format(&cfg, &fmt); /* the gradient needs a full palette */
+    }
+
+    /* 2e) preview: straight from the grid, or summed from Eller rows as they
+          are generated */
+    struct MazePreview *preview = NULL;
+    char preview_path[512];
+    if (preview_width) {
+        preview_filename(preview_path, sizeof preview_path, out_filename, tiles);
+        bool ok;
+        if (m) {
+            struct timespec s, e;
+            clock_gettime(CLOCK_MONOTONIC, &s);
+            ok = write_preview(maze_render_preview(m, &cfg, preview_width, pool), preview_path, pool);
+            clock_gettime(CLOCK_MONOTONIC, &e);
+            if (ok) printf("maze_render_preview() completed in %.3f ms\n", diff_ms(&s, &e));
+        } else {
+            preview = maze_preview_open(width, height, &cfg, start, endp, preview_width);
+            ok = preview != NULL;
+        }
+        if (!ok) {
+            fprintf(stderr, "Error: preview '%s' failed\n", preview_path);
+            maze_file_writer_close(maze_out);
+            maze_solution_free(&solution);
+            maze_distances_free(&distances);
+            maze_free(m);
+            threadpool_free(pool);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* 3-5) streaming: render straight to the file, or to tiles, the image is
+       never in memory */
+    if (stream || tiles) {
+        struct timespec s, e;
+        const char *fn = tiles ? "maze_render_tiles()" : "maze_render_to_file()";
+        bool ok;
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        if (!m && tiles) {
+            /* rows go from the generator into the tile bands as they are emitted */
+            fn = "maze_generate_eller() + maze_tiles_row()";
+            struct MazeTiles *mt = maze_tiles_open(tiles, width, height, &cfg, start, endp, tile_size, pool);
+            struct RowTee tee = { maze_tiles_row, mt, maze_out, preview };
+            ok = mt && maze_generate_eller(width, height, &rng, tee_row, &tee);
+            ok = maze_tiles_close(mt) && ok;
+            if (maze_out) ok = maze_file_writer_close(maze_out) && ok;
+            if (preview) ok = write_preview(maze_preview_close(preview), preview_path, pool) && ok;
+        } else if (!m) {
+            /* rows go from the generator to the file as they are emitted */
+            fn = "maze_generate_eller() + maze_render_stream_row()";
+            struct MazeRenderStream *rs = maze_render_stream_open(out_filename, width, height, &cfg, start, endp);
+            struct RowTee tee = { maze_render_stream_row, rs, maze_out, preview };
+            ok = rs && maze_generate_eller(width, height, &rng, tee_row, &tee);
+            ok = maze_render_stream_close(rs) && ok;
+            if (maze_out) ok = maze_file_writer_close(maze_out) && ok;
+            if (preview) ok = write_preview(maze_preview_close(preview), preview_path, pool) && ok;
+        } else if (tiles) {
+            ok = maze_render_tiles(m, tiles, &cfg, tile_size, pool);
+        } else {
+            ok = maze_render_to_file(m, out_filename, &cfg, pool);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        if (!ok) {
+            fprintf(stderr, "Error: %s failed\n", fn);
+            maze_solution_free(&solution);
+            maze_distances_free(&distances);
+            maze_free(m);
+            threadpool_free(pool);
+            return EXIT_FAILURE;
+        }
+        printf("%s completed in %.3f ms\n", fn, diff_ms(&s, &e));
+
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        printf("Total execution time: %.3f ms\n", diff_ms(&t0, &t1));
+        if (stats >= 0) print_stats(stats);
+        maze_solution_free(&solution);
+        maze_distances_free(&distances);
+        maze_free(m);
+        threadpool_free(pool);
+        return EXIT_SUCCESS;
     }
 
     /* 3) create BMP buffer */
@@ -247,47 +1028,85 @@ int main(int argc, char *argv[]) {
     {
         struct timespec s, e;
         clock_gettime(CLOCK_MONOTONIC, &s);
-        img = bmp_create(width*cell_size, height*cell_size);
-        if (!img) { fprintf(stderr, "Error: bmp_create() failed\n"); maze_free(m); return EXIT_FAILURE; }
+        const char *fn = mapped ? "bmp_create_mapped()" : "bmp_create_format()";
+        img = mapped ? bmp_create_mapped(out_filename, width*cell_size, height*cell_size, &fmt)
+                     : bmp_create_format(width*cell_size, height*cell_size, &fmt);
+        if (!img) {
+            fprintf(stderr, "Error: %s failed\n", fn);
+            maze_file_writer_close(maze_out);
+            bmp_free(maze_preview_close(preview));
+            threadpool_free(pool);
+            maze_solution_free(&solution);
+            maze_distances_free(&distances);
+            maze_free(m);
+            return EXIT_FAILURE;
+        }
         clock_gettime(CLOCK_MONOTONIC, &e);
-        printf("bmp_create() completed in %.3f ms\n", diff_ms(&s, &e));
+        printf("%s completed in %.3f ms\n", fn, diff_ms(&s, &e));
     }
 
-    /* apply colors */
-    MAZE_BG_COLOR    = bgc;
-    MAZE_WALL_COLOR  = wc;
-    MAZE_START_COLOR = sc;
-    MAZE_END_COLOR   = ec;
-
     /* 4) render maze */
-    {
+    if (!m) {
+        /* rows go straight from the generator into the image */
+        struct timespec s, e;
+        clock_gettime(CLOCK_MONOTONIC, &s);
+        struct StreamRender sr = { img, &cfg, malloc(((width + 63) / 64) * sizeof(uint64_t)) };
+        struct RowTee tee = { render_streamed_row, &sr, maze_out, preview };
+        bool ok = sr.prev && maze_generate_eller(width, height, &rng, tee_row, &tee);
+        if (maze_out) ok = maze_file_writer_close(maze_out) && ok;
+        if (preview) ok = write_preview(maze_preview_close(preview), preview_path, pool) && ok;
+        if (!ok) {
+            fprintf(stderr, "Error: maze_generate_eller() failed\n");
+            free(sr.prev);
+            bmp_free(img);
+            threadpool_free(pool);
+            return EXIT_FAILURE;
+        }
+        free(sr.prev);
+        maze_render_markers(img, &cfg, start, endp);
+        clock_gettime(CLOCK_MONOTONIC, &e);
+        printf("maze_generate_eller() + render completed in %.3f ms\n", diff_ms(&s, &e));
+    } else {
         struct timespec s, e;
         clock_gettime(CLOCK_MONOTONIC, &s);
-        maze_render_to_bmp(m, img);
+        maze_render_to_bmp(m, img, &cfg, pool);
+        if (draw_path) maze_render_path(img, &cfg, m, &solution);
         clock_gettime(CLOCK_MONOTONIC, &e);
-        printf("maze_render_to_bmp() completed in %.3f ms\n", diff_ms(&s, &e));
+        printf("%s completed in %.3f ms\n",
+               draw_path ? "maze_render_to_bmp() + maze_render_path()" : "maze_render_to_bmp()", diff_ms(&s, &e));
     }
 
     /* 5) save BMP */
     {
         struct timespec s, e;
         clock_gettime(CLOCK_MONOTONIC, &s);
-        if (!bmp_save(out_filename, img)) {
-            fprintf(stderr, "Error: bmp_save() failed\n");
+        /* a mapped image already is the file: only flush it */
+        const char *fn = png ? "png_save()" : mapped ? "bmp_sync()" : "bmp_save()";
+        bool ok = png ? png_save(out_filename, img, pool)
+                : mapped ? bmp_sync(img) : bmp_save(out_filename, img);
+        if (!ok) {
+            fprintf(stderr, "Error: %s failed\n", fn);
             bmp_free(img);
+            maze_solution_free(&solution);
+            maze_distances_free(&distances);
             maze_free(m);
+            threadpool_free(pool);
             return EXIT_FAILURE;
         }
         clock_gettime(CLOCK_MONOTONIC, &e);
-        printf("bmp_save() completed in %.3f ms\n", diff_ms(&s, &e));
+        printf("%s completed in %.3f ms\n", fn, diff_ms(&s, &e));
     }
 
     /* end total timer */
     clock_gettime(CLOCK_MONOTONIC, &t1);
     printf("Total execution time: %.3f ms\n", diff_ms(&t0, &t1));
+    if (stats >= 0) print_stats(stats);
 
     /* cleanup */
     bmp_free(img);
+    maze_solution_free(&solution);
+    maze_distances_free(&distances);
     maze_free(m);
+    threadpool_free(pool);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,132 @@
+#include "maze_generator.h"
+#include "../maze_stats/maze_stats.h"
+
+#include <stdlib.h> // for malloc, free
+
+typedef struct Maze Maze;
+typedef struct Rng Rng;
+typedef struct Stack Stack;
+typedef enum Direction Direction;
+
+// Blocked cell layout
+// -------------------
+// In the row-major grid the cell above or below is a whole bit row away, so
+// a DFS step that moves vertically lands on a new cache line, and on big grids
+// a new page, almost every time. Here the grid is cut into 8x8-cell blocks and
+// each block keeps all three bits of its 64 cells (visited, east wall, south
+// wall) together in 24 bytes: bit (y & 7) * 8 + (x & 7) of each word. Seven
+// steps in eight, in any direction, stay inside the block. Blocks are stored
+// block row by block row.
+struct CellBlock {
+    uint64_t visited;
+    uint64_t east;
+    uint64_t south;
+};
+
+struct BlockGrid {
+    struct CellBlock *blocks;
+    size_t stride; // Blocks per block row, (width + 7) / 8
+    size_t rows; // Block rows, (height + 7) / 8
+};
+
+static inline struct CellBlock *block_at(const struct BlockGrid *g, size_t x, size_t y) {
+    return g->blocks + (y >> 3) * g->stride + (x >> 3); // Block holding cell (x, y)
+}
+
+static inline uint64_t block_bit(size_t x, size_t y) {
+    return (uint64_t)1 << ((y & 7) << 3 | (x & 7)); // Bit of cell (x, y) in its block's words
+}
+
+static inline bool block_visited(const struct BlockGrid *g, size_t x, size_t y) {
+    return (block_at(g, x, y)->visited & block_bit(x, y)) != 0;
+}
+
+// The DFS of maze_generate_dfs_region over the whole grid, making the same
+// draws in the same order, so it carves the same maze
+static bool carve(const Maze *m, const struct BlockGrid *g, Rng *rng, Stack *stack) {
+    size_t w = m->width, h = m->height;
+    size_t sx = (size_t)m->start.x, sy = (size_t)m->start.y;
+
+    clearStack(stack);
+    block_at(g, sx, sy)->visited |= block_bit(sx, sy);
+    if (!push(stack, (uint32_t)maze_cell_index(m, sx, sy))) return false;
+
+    while (!isEmpty(stack)) {
+        uint32_t current = peek(stack);
+        size_t x = current % w, y = current / w;
+        Direction candidates[4];
+        uint32_t n = 0;
+
+        if (y > 0 && !block_visited(g, x, y - 1)) candidates[n++] = UP;
+        if (x + 1 < w && !block_visited(g, x + 1, y)) candidates[n++] = RIGHT;
+        if (y + 1 < h && !block_visited(g, x, y + 1)) candidates[n++] = DOWN;
+        if (x > 0 && !block_visited(g, x - 1, y)) candidates[n++] = LEFT;
+        MAZE_STAT_ADD(visited_probes, (y > 0) + (x + 1 < w) + (y + 1 < h) + (x > 0) - n);
+
+        if (n == 0) {
+            MAZE_STAT_ADD(backtracks, 1);
+            pop(stack);
+            continue;
+        }
+
+        size_t nx = x, ny = y;
+        switch (n == 1 ? candidates[0] : candidates[rng_bounded(rng, n)]) {
+            case UP:    ny = y - 1; block_at(g, nx, ny)->south &= ~block_bit(nx, ny); break;
+            case DOWN:  ny = y + 1; block_at(g, x, y)->south &= ~block_bit(x, y); break;
+            case LEFT:  nx = x - 1; block_at(g, nx, ny)->east &= ~block_bit(nx, ny); break;
+            case RIGHT: nx = x + 1; block_at(g, x, y)->east &= ~block_bit(x, y); break;
+        }
+        block_at(g, nx, ny)->visited |= block_bit(nx, ny);
+        if (!push(stack, (uint32_t)maze_cell_index(m, nx, ny))) return false;
+    }
+    return true;
+}
+
+static inline uint64_t plane_word(const struct CellBlock *b, int plane) {
+    return plane == 0 ? b->visited : plane == 1 ? b->east : b->south;
+}
+
+// Write cell row y of one plane in scanline order: byte (y & 7) of a block
+// word is its part of the row, so each row word gathers a byte from eight
+// blocks. Bits past the last column are cleared, as the grid requires.
+static void unblock_row(const Maze *m, const struct BlockGrid *g, int plane, size_t y, uint64_t *dst) {
+    const struct CellBlock *row = g->blocks + (y >> 3) * g->stride;
+    unsigned shift = (y & 7) * 8;
+    for (size_t w = 0; w < m->row_words; ++w) {
+        uint64_t word = 0;
+        for (size_t k = 0; k < 8 && w * 8 + k < g->stride; ++k) {
+            word |= (plane_word(&row[w * 8 + k], plane) >> shift & 0xFF) << (k * 8);
+        }
+        dst[w] = word;
+    }
+    if (m->width & 63) dst[m->row_words - 1] &= maze_bit_mask(m->width) - 1;
+}
+
+bool maze_generate_dfs_blocked(struct Maze *m, struct Rng *rng) {
+    if (!m || !m->walls || !rng || m->file) return false;
+
+    if (!m->stack) {
+        m->stack = createStack(-1); // -1 for unlimited capacity
+        if (!m->stack) return false;
+    }
+
+    // All walls present and nothing visited; the start is marked by carve
+    struct BlockGrid g = { NULL, (m->width + 7) / 8, (m->height + 7) / 8 };
+    g.blocks = malloc(g.stride * g.rows * sizeof(struct CellBlock));
+    if (!g.blocks) return false;
+    for (size_t i = 0; i < g.stride * g.rows; ++i) {
+        g.blocks[i] = (struct CellBlock){ 0, ~(uint64_t)0, ~(uint64_t)0 };
+    }
+
+    bool ok = carve(m, &g, rng, m->stack);
+    if (ok) {
+        size_t rw = m->row_words;
+        for (size_t y = 0; y < m->height; ++y) {
+            unblock_row(m, &g, 0, y, m->visited + y * rw);
+            unblock_row(m, &g, 1, y, m->walls + y * 2 * rw);
+            unblock_row(m, &g, 2, y, m->walls + y * 2 * rw + rw);
+        }
+    }
+    free(g.blocks);
+    return ok;
+}
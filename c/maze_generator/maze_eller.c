@@ -0,0 +1,125 @@
+#include "maze_generator.h"
+
+#include <stdlib.h> // for malloc, free
+#include <string.h> // for memset
+
+typedef struct MazeRow MazeRow;
+typedef struct Rng Rng;
+
+#define NO_SET UINT32_MAX // Label of a cell that has not joined a set yet
+
+// Coin flips are taken one bit at a time from 64-bit draws
+struct BitSource {
+    Rng *rng;
+    uint64_t bits;
+    int left;
+};
+
+static inline bool next_bit(struct BitSource *src) {
+    if (src->left == 0) {
+        src->bits = rng_next(src->rng);
+        src->left = 64;
+    }
+    bool bit = src->bits & 1;
+    src->bits >>= 1;
+    src->left--;
+    return bit;
+}
+
+// Union-find root of a set label, halving the path on the way
+static inline uint32_t find_set(uint32_t *parent, uint32_t s) {
+    while (parent[s] != s) {
+        parent[s] = parent[parent[s]];
+        s = parent[s];
+    }
+    return s;
+}
+
+bool maze_generate_eller(size_t width, size_t height, Rng *rng, MazeRowCallback emit, void *user) {
+    if (width == 0 || height == 0 || width >= UINT32_MAX || !rng || !emit) return false;
+
+    // Everything below is proportional to the width; rows are never kept
+    size_t row_words = (width + 63) / 64;
+    uint64_t *bits = malloc(2 * row_words * sizeof(uint64_t)); // east words, then south words
+    uint32_t *set = malloc(width * sizeof(uint32_t)); // set label of each cell in the current row
+    uint32_t *parent = malloc(width * sizeof(uint32_t)); // label union-find while joining a row
+    uint32_t *members = malloc(width * sizeof(uint32_t)); // cells of each set still undecided in the vertical pass
+    uint32_t *free_labels = malloc(width * sizeof(uint32_t)); // labels unused by the next row
+    uint8_t *carried = malloc(width); // per label: the set continues into the next row
+    bool ok = bits && set && parent && members && free_labels && carried;
+
+    uint64_t tail = (width & 63) ? ((uint64_t)1 << (width & 63)) - 1 : ~(uint64_t)0;
+    struct BitSource coin = { rng, 0, 0 };
+    MazeRow row = { 0, width, row_words, bits, bits + row_words };
+
+    // Every cell of the first row starts in its own set
+    for (size_t x = 0; ok && x < width; ++x) {
+        set[x] = (uint32_t)x;
+    }
+
+    for (size_t y = 0; ok && y < height; ++y) {
+        bool last = y + 1 == height;
+        memset(bits, 0xFF, 2 * row_words * sizeof(uint64_t));
+        bits[row_words - 1] = tail;
+        bits[2 * row_words - 1] = tail;
+
+        // Join adjacent cells of different sets at random (always on the last row)
+        for (size_t l = 0; l < width; ++l) {
+            parent[l] = (uint32_t)l;
+        }
+        for (size_t x = 0; x + 1 < width; ++x) {
+            uint32_t a = find_set(parent, set[x]);
+            uint32_t b = find_set(parent, set[x + 1]);
+            if (a != b && (last || next_bit(&coin))) {
+                parent[b] = a;
+                bits[x >> 6] &= ~((uint64_t)1 << (x & 63));
+            }
+        }
+        for (size_t x = 0; x < width; ++x) {
+            set[x] = find_set(parent, set[x]);
+        }
+
+        if (last) {
+            row.y = y;
+            ok = emit(&row, user);
+            break;
+        }
+
+        // Carve down at random, but at least once per set so none is cut off
+        memset(members, 0, width * sizeof(uint32_t));
+        memset(carried, 0, width);
+        for (size_t x = 0; x < width; ++x) {
+            members[set[x]]++;
+        }
+        for (size_t x = 0; x < width; ++x) {
+            uint32_t l = set[x];
+            members[l]--;
+            if (next_bit(&coin) || (members[l] == 0 && !carried[l])) {
+                bits[row_words + (x >> 6)] &= ~((uint64_t)1 << (x & 63));
+                carried[l] = 1;
+            } else {
+                set[x] = NO_SET;
+            }
+        }
+
+        row.y = y;
+        ok = emit(&row, user);
+
+        // Cells below a wall start new sets with labels no carried set uses
+        size_t n_free = 0;
+        for (size_t l = 0; l < width; ++l) {
+            if (!carried[l]) free_labels[n_free++] = (uint32_t)l;
+        }
+        for (size_t x = 0; x < width; ++x) {
+            if (set[x] == NO_SET) set[x] = free_labels[--n_free];
+        }
+    }
+
+    free(bits);
+    free(set);
+    free(parent);
+    free(members);
+    free(free_labels);
+    free(carried);
+    return ok;
+}
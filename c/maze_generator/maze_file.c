@@ -0,0 +1,245 @@
+#include "maze_generator.h"
+
+#include <stdio.h>  // for FILE, fopen, fwrite, fclose
+#include <stdlib.h> // for malloc, calloc, free
+#include <string.h> // for memcpy, memcmp
+
+#ifndef _WIN32
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap, munmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+#endif
+
+typedef struct Maze Maze;
+typedef struct MazeRegion MazeRegion;
+typedef struct MazeRow MazeRow;
+typedef struct MazeFileInfo MazeFileInfo;
+typedef struct MazeFileWriter MazeFileWriter;
+typedef struct Point Point;
+
+// On-disk header, written in host byte order (a file from a host of the other
+// endianness fails the version check). The wall rows follow at header_size,
+// exactly as they sit in Maze.walls, so a mapping of the file is the grid.
+struct MazeFileHeader {
+    char magic[8]; // MAZE_FILE_MAGIC
+    uint32_t version; // MAZE_FILE_VERSION
+    uint32_t header_size; // Offset of the wall rows, a multiple of 8
+    uint64_t width; // in cells
+    uint64_t height; // in cells
+    uint32_t start_x; // Cell coordinates, below width and height
+    uint32_t start_y;
+    uint32_t end_x;
+    uint32_t end_y;
+    uint64_t seed; // Seed the maze was generated from
+    uint32_t algorithm; // enum MazeAlgorithm
+    uint32_t row_words; // 64-bit words per bit row
+};
+
+_Static_assert(sizeof(struct MazeFileHeader) == 64, "MazeFileHeader must stay 64 bytes");
+
+static const char MAZE_FILE_MAGIC[8] = { 'M', 'A', 'Z', 'E', 'G', 'R', 'I', 'D' };
+
+struct MazeFileWriter {
+    FILE *fp;
+    size_t height; // Rows expected
+    size_t rows_written;
+    size_t row_words;
+    bool ok; // Cleared by the first failed write
+};
+
+MazeFileWriter *maze_file_writer_open(const char *filename, size_t width, size_t height, Point start, Point end, const MazeFileInfo *info) {
+    if (!filename || width == 0 || height == 0 || width >= UINT32_MAX || !info) return NULL;
+
+    MazeFileWriter *w = malloc(sizeof *w);
+    if (!w) return NULL;
+    w->fp = fopen(filename, "wb");
+    if (!w->fp) {
+        free(w);
+        return NULL;
+    }
+    w->height = height;
+    w->rows_written = 0;
+    w->row_words = (width + 63) / 64;
+
+    struct MazeFileHeader h;
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, MAZE_FILE_MAGIC, sizeof h.magic);
+    h.version = MAZE_FILE_VERSION;
+    h.header_size = sizeof h;
+    h.width = width;
+    h.height = height;
+    h.start_x = (uint32_t)start.x;
+    h.start_y = (uint32_t)start.y;
+    h.end_x = (uint32_t)end.x;
+    h.end_y = (uint32_t)end.y;
+    h.seed = info->seed;
+    h.algorithm = (uint32_t)info->algorithm;
+    h.row_words = (uint32_t)w->row_words;
+    w->ok = fwrite(&h, sizeof h, 1, w->fp) == 1;
+    MAZE_STAT_ADD(bytes_written, sizeof h);
+    return w;
+}
+
+bool maze_file_writer_row(const MazeRow *row, void *user) {
+    MazeFileWriter *w = user;
+    if (!w->ok || row->y != w->rows_written || row->row_words != w->row_words) {
+        w->ok = false;
+        return false;
+    }
+    w->ok = fwrite(row->east, sizeof(uint64_t), w->row_words, w->fp) == w->row_words &&
+            fwrite(row->south, sizeof(uint64_t), w->row_words, w->fp) == w->row_words;
+    MAZE_STAT_ADD(bytes_written, 2 * w->row_words * sizeof(uint64_t));
+    w->rows_written++;
+    return w->ok;
+}
+
+bool maze_file_writer_close(MazeFileWriter *w) {
+    if (!w) return false;
+    bool ok = w->ok && w->rows_written == w->height;
+    ok = fclose(w->fp) == 0 && ok;
+    free(w);
+    return ok;
+}
+
+bool maze_save(const Maze *m, const char *filename, const MazeFileInfo *info) {
+    if (!m || !m->walls) return false;
+    MazeFileWriter *w = maze_file_writer_open(filename, m->width, m->height, m->start, m->end, info);
+    if (!w) return false;
+
+    // The grid already is the file layout: one write for all rows
+    size_t words = m->height * 2 * m->row_words;
+    w->ok = w->ok && fwrite(m->walls, sizeof(uint64_t), words, w->fp) == words;
+    MAZE_STAT_ADD(bytes_written, words * sizeof(uint64_t));
+    w->rows_written = m->height;
+    return maze_file_writer_close(w);
+}
+
+// Seek to a 64-bit offset; a long is 32 bits on Windows
+static bool seek_to(FILE *fp, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool maze_save_region(const Maze *m, const char *filename, const MazeRegion *region) {
+    if (!m || !m->walls || !filename || !region) return false;
+    const MazeRegion *r = region;
+    if (r->x0 >= r->x1 || r->y0 >= r->y1 || r->x1 > m->width || r->y1 > m->height) return false;
+
+    FILE *fp = fopen(filename, "r+b");
+    if (!fp) return false;
+
+    // The file must hold this maze's grid
+    struct MazeFileHeader h;
+    bool ok = fread(&h, sizeof h, 1, fp) == 1 &&
+              memcmp(h.magic, MAZE_FILE_MAGIC, sizeof h.magic) == 0 && h.version == MAZE_FILE_VERSION &&
+              h.width == m->width && h.height == m->height && h.row_words == m->row_words;
+
+    // The words covering the region's columns, of both bit rows of each of its cell rows
+    size_t w0 = r->x0 >> 6, words = ((r->x1 - 1) >> 6) - w0 + 1;
+    for (size_t y = r->y0; ok && y < r->y1; ++y) {
+        for (int plane = 0; ok && plane < 2; ++plane) {
+            size_t word = (y * 2 + plane) * m->row_words + w0;
+            ok = seek_to(fp, h.header_size + (uint64_t)word * sizeof(uint64_t)) &&
+                 fwrite(m->walls + word, sizeof(uint64_t), words, fp) == words;
+        }
+    }
+    if (ok) MAZE_STAT_ADD(bytes_written, (r->y1 - r->y0) * 2 * words * sizeof(uint64_t));
+    if (fclose(fp) != 0) ok = false;
+    return ok;
+}
+
+// Check that a header describes a grid the rest of the code can address and
+// that the file holds all of its rows
+static bool valid_header(const struct MazeFileHeader *h, size_t file_size) {
+    if (memcmp(h->magic, MAZE_FILE_MAGIC, sizeof h->magic) != 0) return false;
+    if (h->version != MAZE_FILE_VERSION) return false;
+    if (h->header_size < sizeof *h || h->header_size % 8 != 0 || h->header_size > file_size) return false;
+    if (h->width == 0 || h->height == 0 || h->width >= UINT32_MAX) return false;
+    if (h->height > UINT32_MAX / h->width) return false; // Cell indices are 32-bit
+    if (h->row_words != (h->width + 63) / 64) return false;
+    if (h->start_x >= h->width || h->start_y >= h->height) return false;
+    if (h->end_x >= h->width || h->end_y >= h->height) return false;
+    if (h->height > (SIZE_MAX - h->header_size) / (2 * h->row_words * sizeof(uint64_t))) return false;
+    return file_size == h->header_size + h->height * 2 * h->row_words * sizeof(uint64_t);
+}
+
+Maze *maze_load(const char *filename, uint32_t cell_size, uint32_t wall_thickness, MazeFileInfo *out_info) {
+    if (!filename) return NULL;
+
+    uint8_t *file;
+    size_t file_size;
+#ifdef _WIN32
+    // No mmap: read the whole file into memory
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return NULL;
+    if (fseek(fp, 0, SEEK_END) != 0) { fclose(fp); return NULL; }
+    long len = ftell(fp);
+    if (len < (long)sizeof(struct MazeFileHeader) || fseek(fp, 0, SEEK_SET) != 0) { fclose(fp); return NULL; }
+    file_size = (size_t)len;
+    file = malloc(file_size);
+    if (!file || fread(file, 1, file_size, fp) != file_size) {
+        free(file);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(struct MazeFileHeader)) {
+        close(fd);
+        return NULL;
+    }
+    file_size = (size_t)sb.st_size;
+    // Private and writable: the maze can be edited or regenerated in place
+    // without touching the file, and pages are only read when first used
+    file = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) return NULL;
+#endif
+
+    struct MazeFileHeader h;
+    memcpy(&h, file, sizeof h);
+    Maze *m = NULL;
+    if (valid_header(&h, file_size)) m = malloc(sizeof *m);
+    if (m) {
+        m->width = h.width;
+        m->height = h.height;
+        m->cell_size = cell_size;
+        m->start = (Point){ h.start_x, h.start_y };
+        m->end = (Point){ h.end_x, h.end_y };
+        m->wall_thickness = wall_thickness;
+        m->row_words = h.row_words;
+        m->walls = (uint64_t *)(file + h.header_size);
+        m->file = file;
+        m->file_size = file_size;
+        m->stack = NULL;
+        m->capacity = 0; // Not reshapable: walls belong to the file
+        // Zero pages come from the kernel on demand, so this costs nothing
+        // until the maze is solved or regenerated
+        m->visited = calloc(m->height * m->row_words, sizeof(uint64_t));
+        if (!m->visited) {
+            free(m);
+            m = NULL;
+        }
+    }
+    if (!m) {
+#ifdef _WIN32
+        free(file);
+#else
+        munmap(file, file_size);
+#endif
+        return NULL;
+    }
+
+    if (out_info) {
+        out_info->seed = h.seed;
+        out_info->algorithm = (enum MazeAlgorithm)h.algorithm;
+    }
+    return m;
+}
@@ -1,37 +1,66 @@
 #include "maze_generator.h"
 
-#include <stdio.h>  // for FILE, fopen, fclose, fwrite
 #include <stdlib.h> // for malloc, free
 #include <math.h>  // for floor
-#include <string.h> // for memset
+#include <string.h> // for memcpy, memset
+#include <stdint.h> // for UINT32_MAX, SIZE_MAX
+
+#ifndef _WIN32
+#include <sys/mman.h> // for munmap
+#endif
 
-typedef struct RGBTriple RGBTriple;
-typedef struct BmpImage BmpImage;
-typedef struct BmpFileHeader BmpFileHeader;
-typedef struct BmpInfoHeader BmpInfoHeader;
-typedef struct Cell Cell;
 typedef struct Point Point;
 typedef struct Maze Maze;
 typedef enum Direction Direction;
 typedef struct Stack Stack;
-typedef struct StackNode StackNode;
-
-RGBTriple MAZE_START_COLOR = {0, 255, 0}; // default start color
-RGBTriple MAZE_END_COLOR = {255, 0, 0};   // default end color
-RGBTriple MAZE_WALL_COLOR = {0, 0, 0};    // default wall color
-RGBTriple MAZE_BG_COLOR = {255, 255, 255}; // default background color
+typedef struct Rng Rng;
+typedef struct MazeRegion MazeRegion;
+
+// Choose uniformly among the unvisited neighbors of (x, y) inside region r
+// with a single bounded draw; false if every neighbor has been visited
+static bool pick_unvisited_neighbor(const Maze *m, const MazeRegion *r, size_t x, size_t y, Rng *rng, Direction *out_dir) {
+    Direction candidates[4];
+    uint32_t n = 0;
+
+    if (y > r->y0 && !(*maze_visited_word(m, x, y - 1) & maze_bit_mask(x))) candidates[n++] = UP;
+    if (x + 1 < r->x1 && !(*maze_visited_word(m, x + 1, y) & maze_bit_mask(x + 1))) candidates[n++] = RIGHT;
+    if (y + 1 < r->y1 && !(*maze_visited_word(m, x, y + 1) & maze_bit_mask(x))) candidates[n++] = DOWN;
+    if (x > r->x0 && !(*maze_visited_word(m, x - 1, y) & maze_bit_mask(x - 1))) candidates[n++] = LEFT;
+    MAZE_STAT_ADD(visited_probes, (y > r->y0) + (x + 1 < r->x1) + (y + 1 < r->y1) + (x > r->x0) - n);
+
+    if (n == 0) return false;
+    *out_dir = n == 1 ? candidates[0] : candidates[rng_bounded(rng, n)];
+    return true;
+}
 
 struct Maze* maze_create(size_t width, size_t height, uint32_t cell_size, struct Point start, struct Point end, uint32_t wall_thickness) {
+    struct Maze *maze = calloc(1, sizeof(struct Maze)); // No storage yet; the stack is created by the first generate call
+    if (!maze) {
+        return NULL; // Memory allocation failed
+    }
+
+    if (!maze_reshape(maze, width, height, cell_size, start, end, wall_thickness)) {
+        maze_free(maze);
+        return NULL; // Invalid parameters or allocation failed
+    }
+    return maze;
+}
+
+bool maze_reshape(struct Maze *m, size_t width, size_t height, uint32_t cell_size, struct Point start, struct Point end, uint32_t wall_thickness) {
+    if (!m || m->file) {
+        return false; // A loaded maze's grid is its file
+    }
+
     if (width == 0 || height == 0 || cell_size <= 0 || wall_thickness < 0) {
-        return NULL; // Invalid parameters
+        return false; // Invalid parameters
     }
 
     if (start.x < 0 || start.x >= width || start.y < 0 || start.y >= height) {
-        return NULL; // Invalid start coordinates
+        return false; // Invalid start coordinates
     }
 
     if (end.x < 0 || end.x >= width || end.y < 0 || end.y >= height) {
-        return NULL; // Invalid end coordinates
+        return false; // Invalid end coordinates
     }
 
     if (wall_thickness >= floor(cell_size / 2)) {
@@ -42,176 +71,216 @@ struct Maze* maze_create(size_t width, size_t height, uint32_t cell_size, struct
         wall_thickness = 1; // Minimum wall thickness
     }
 
-    struct Maze *maze = malloc(sizeof(struct Maze));
-    if (!maze) {
-        return NULL; // Memory allocation failed
-    }
-
-    maze->width = width;
-    maze->height = height;
-    maze->cell_size = cell_size;
-    maze->start = start;
-    maze->end = end;
-    maze->wall_thickness = wall_thickness;
-    maze->cells = malloc(height * sizeof(struct Cell *));
-    if (!maze->cells) {
-        free(maze);
-        return NULL; // Memory allocation failed
+    if (height > UINT32_MAX / width) {
+        return false; // Cell indices must fit the 32-bit DFS stack
     }
 
-    struct Cell *block = malloc(width * height * sizeof(struct Cell));
-    if (!block) {
-        free(maze->cells);
-        free(maze);
-        return NULL; // Memory allocation failed
+    size_t row_words = (width + 63) / 64;
+    if (height > SIZE_MAX / (2 * row_words * sizeof(uint64_t))) {
+        return false; // Grid too large to address
     }
 
-    for (size_t y = 0; y < height; ++y) {
-        maze->cells[y] = &block[y * width];
-        for (size_t x = 0; x < width; ++x) {
-            struct Cell *cell = &maze->cells[y][x];
-            cell->position.x = x;
-            cell->position.y = y;
-            cell->visited = false;
-            memset(cell->walls, true, sizeof(cell->walls)); // All walls present
+    // Grow the storage only when the new grid does not fit; the old bits
+    // are overwritten by maze_reset anyway
+    size_t words = height * row_words;
+    if (words > m->capacity) {
+        uint64_t *walls = malloc(2 * words * sizeof(uint64_t));
+        uint64_t *visited = malloc(words * sizeof(uint64_t));
+        if (!walls || !visited) {
+            free(walls);
+            free(visited);
+            return false; // Memory allocation failed, the maze keeps its old shape
         }
+        free(m->walls);
+        free(m->visited);
+        m->walls = walls;
+        m->visited = visited;
+        m->capacity = words;
     }
-    maze->cells[start.y][start.x].visited = true; // Mark start cell as visited
-    return maze;
 
+    m->width = width;
+    m->height = height;
+    m->cell_size = cell_size;
+    m->start = start;
+    m->end = end;
+    m->wall_thickness = wall_thickness;
+    m->row_words = row_words;
+
+    maze_reset(m); // All walls present, only the start cell visited
+    return true;
 }
 
 void maze_free(struct Maze *m) {
     if (m) {
-        free(m->cells[0]); // Free the block of cells
-        free(m->cells);    // Free the array of pointers
+        if (m->file) {
+            // The wall bits live inside a loaded .maze file
+#ifdef _WIN32
+            free(m->file);
+#else
+            munmap(m->file, m->file_size);
+#endif
+        } else {
+            free(m->walls); // Free the wall bits
+        }
+        free(m->visited); // Free the visited bits
+        freeStack(m->stack); // Free the DFS stack
         free(m);          // Free the maze structure
     }
 }
 
 void maze_reset(struct Maze *m) {
     if (!m) return;
+    size_t rw = m->row_words;
+    uint64_t tail = (m->width & 63) ? maze_bit_mask(m->width) - 1 : ~(uint64_t)0; // Valid bits of the last word
     for (size_t y = 0; y < m->height; ++y) {
-        for (size_t x = 0; x < m->width; ++x) {
-            struct Cell *c = &m->cells[y][x];
-            c->visited = false; // Reset visited status
-            memset(c->walls, true, sizeof(c->walls)); // Restore all walls
-        }
+        uint64_t *row = m->walls + y * 2 * rw;
+        memset(row, 0xFF, 2 * rw * sizeof(uint64_t)); // Restore all walls
+        row[rw - 1] = tail;     // Keep bits past the last column clear
+        row[2 * rw - 1] = tail;
+    }
+    memset(m->visited, 0, m->height * rw * sizeof(uint64_t)); // Reset visited status
+    if (m->stack) {
+        clearStack(m->stack); // Keep the storage for the next generate cycle
     }
     // Mark start cell as visited
-    if (m->start.x >= 0 && m->start.x < (int)m->width &&
-        m->start.y >= 0 && m->start.y < (int)m->height) {
-        m->cells[m->start.y][m->start.x].visited = true;
+    if (m->start.x >= 0 && m->start.x < (int64_t)m->width &&
+        m->start.y >= 0 && m->start.y < (int64_t)m->height) {
+        *maze_visited_word(m, m->start.x, m->start.y) |= maze_bit_mask(m->start.x);
     }
 }
 
-void maze_generate_dfs(struct Maze *m) {
-    if (!m || !m->cells) return;
+bool maze_generate_dfs(struct Maze *m, struct Rng *rng) {
+    if (!m || !m->walls || !rng) return false;
 
     // Reset the maze to initial state
     maze_reset(m);
 
-    // Create a stack to hold pointers to cells
-    Stack *stack = createStack(-1); // -1 for unlimited capacity
-    if (!stack) return; // Stack creation failed
+    // The stack of cell indices lives with the maze so its storage is reused
+    if (!m->stack) {
+        m->stack = createStack(-1); // -1 for unlimited capacity
+        if (!m->stack) return false; // Stack creation failed
+    }
+
+    MazeRegion all = { 0, 0, m->width, m->height };
+    return maze_generate_dfs_region(m, rng, m->stack, &all, maze_cell_index(m, m->start.x, m->start.y));
+}
+
+bool maze_generate_dfs_region(struct Maze *m, struct Rng *rng, struct Stack *stack, const struct MazeRegion *region, size_t start_cell) {
+    if (!m || !m->walls || !rng || !stack || !region) return false;
+
+    clearStack(stack);
 
     // Get the starting cell
-    struct Cell *start_cell = &m->cells[m->start.y][m->start.x];
-    start_cell->visited = true;
-    push(stack, start_cell);
+    maze_set_visited(m, start_cell);
+    if (!push(stack, (uint32_t)start_cell)) {
+        return false; // Out of memory
+    }
 
     while (!isEmpty(stack)) {
-        struct Cell *current = (struct Cell *)peek(stack);
+        uint32_t current = peek(stack);
+        size_t x = current % m->width, y = current / m->width;
         Direction dir;
 
-        if (maze_has_unvisited_neighbor(m, current, &dir)) {
-            // Get the neighboring cell in the chosen direction
-            struct Cell *neighbor = maze_get_neighbor(m, current, dir);
-            if (neighbor) {
-                // Remove the wall between current and neighbor
-                maze_remove_wall(current, neighbor, dir);
-                neighbor->visited = true;
-                push(stack, neighbor);
+        if (pick_unvisited_neighbor(m, region, x, y, rng, &dir)) {
+            // Remove the wall between current and the neighbor in the chosen direction
+            size_t nx = x, ny = y;
+            switch (dir) {
+                case UP:    ny = y - 1; *maze_south_word(m, nx, ny) &= ~maze_bit_mask(nx); break;
+                case DOWN:  ny = y + 1; *maze_south_word(m, x, y) &= ~maze_bit_mask(x); break;
+                case LEFT:  nx = x - 1; *maze_east_word(m, nx, ny) &= ~maze_bit_mask(nx); break;
+                case RIGHT: nx = x + 1; *maze_east_word(m, x, y) &= ~maze_bit_mask(x); break;
+            }
+            *maze_visited_word(m, nx, ny) |= maze_bit_mask(nx);
+            if (!push(stack, (uint32_t)maze_cell_index(m, nx, ny))) {
+                return false; // Out of memory
             }
         } else {
             // Backtrack
+            MAZE_STAT_ADD(backtracks, 1);
             pop(stack);
         }
     }
+    return true;
+}
 
-    // Clean up
-    freeStack(stack, NULL);
+struct Point maze_cell_position(const struct Maze *m, size_t cell) {
+    Point p = { (int64_t)(cell % m->width), (int64_t)(cell / m->width) };
+    return p;
 }
 
-void shuffle_directions(Direction *dir, int n)
-{
-    for (int i = n - 1; i > 0; --i)
-    {
-        int j = rand() % (i + 1);
-        Direction temp = dir[i];
-        dir[i] = dir[j];
-        dir[j] = temp;
-    }
+bool maze_is_visited(const struct Maze *m, size_t cell) {
+    size_t x = cell % m->width, y = cell / m->width;
+    return (*maze_visited_word(m, x, y) & maze_bit_mask(x)) != 0;
 }
 
-bool maze_has_unvisited_neighbor(const struct Maze *m, const struct Cell *c, enum Direction *out_dir) {
-    if (!m || !m->cells || !c) return false;
+void maze_set_visited(struct Maze *m, size_t cell) {
+    size_t x = cell % m->width, y = cell / m->width;
+    *maze_visited_word(m, x, y) |= maze_bit_mask(x);
+}
 
-    Direction dirs[4] = {UP, RIGHT, DOWN, LEFT};
-    shuffle_directions(dirs, 4);
+bool maze_has_wall(const struct Maze *m, size_t cell, enum Direction dir) {
+    if (!m || !m->walls) return true;
 
-    for (int i = 0; i < 4; ++i) {
-        struct Cell *neighbor = maze_get_neighbor(m, c, dirs[i]);
-        if (neighbor && !neighbor->visited) {
-            if (out_dir) {
-                *out_dir = dirs[i];
-            }
-            return true;
-        }
+    size_t x = cell % m->width, y = cell / m->width;
+    switch (dir) {
+        case UP:    return y == 0 || (*maze_south_word(m, x, y - 1) & maze_bit_mask(x));
+        case DOWN:  return (*maze_south_word(m, x, y) & maze_bit_mask(x)) != 0;
+        case LEFT:  return x == 0 || (*maze_east_word(m, x - 1, y) & maze_bit_mask(x - 1));
+        case RIGHT: return (*maze_east_word(m, x, y) & maze_bit_mask(x)) != 0;
+        default:    return true; // invalid enum value
     }
-    return false;
 }
 
-struct Cell* maze_get_neighbor(const struct Maze *m, const struct Cell *c, enum Direction dir) {
-    if (!m || !m->cells || !c) return NULL;
+bool maze_has_unvisited_neighbor(const struct Maze *m, size_t cell, struct Rng *rng, enum Direction *out_dir) {
+    if (!m || !m->walls || !rng) return false;
 
-    int dx = 0, dy = 0;
-    switch (dir) {
-        case UP:    dy = -1; break;
-        case DOWN:  dy = +1; break;
-        case LEFT:  dx = -1; break;
-        case RIGHT: dx = +1; break;
-        default:    return NULL; // invalid enum value
+    MazeRegion all = { 0, 0, m->width, m->height };
+    Direction dir;
+    if (!pick_unvisited_neighbor(m, &all, cell % m->width, cell / m->width, rng, &dir)) {
+        return false;
+    }
+    if (out_dir) {
+        *out_dir = dir;
     }
+    return true;
+}
+
+bool maze_get_neighbor(const struct Maze *m, size_t cell, enum Direction dir, size_t *out_neighbor) {
+    if (!m || !m->walls) return false;
 
-    int nx = c->position.x + dx;
-    int ny = c->position.y + dy;
-    if (nx < 0 || nx >= (int)m->width || ny < 0 || ny >= (int)m->height) {
-        return NULL; // Out of bounds
+    size_t x = cell % m->width, y = cell / m->width;
+    switch (dir) {
+        case UP:    if (y == 0) return false; cell -= m->width; break;
+        case DOWN:  if (y + 1 >= m->height) return false; cell += m->width; break;
+        case LEFT:  if (x == 0) return false; cell -= 1; break;
+        case RIGHT: if (x + 1 >= m->width) return false; cell += 1; break;
+        default:    return false; // invalid enum value
     }
 
-    return &m->cells[ny][nx];
+    if (out_neighbor) {
+        *out_neighbor = cell;
+    }
+    return true;
 }
 
-void maze_remove_wall(struct Cell *c1, struct Cell *c2, enum Direction dir) {
-    if (!c1 || !c2) return;
+void maze_remove_wall(struct Maze *m, size_t cell, enum Direction dir) {
+    if (!m || !m->walls) return;
 
+    // Every interior wall is stored once, as the east or south wall of the
+    // cell to its left or above
+    size_t x = cell % m->width, y = cell / m->width;
     switch (dir) {
         case UP:
-            c1->walls[UP] = false;
-            c2->walls[DOWN] = false;
+            if (y > 0) *maze_south_word(m, x, y - 1) &= ~maze_bit_mask(x);
             break;
         case DOWN:
-            c1->walls[DOWN] = false;
-            c2->walls[UP] = false;
+            if (y + 1 < m->height) *maze_south_word(m, x, y) &= ~maze_bit_mask(x);
             break;
         case LEFT:
-            c1->walls[LEFT] = false;
-            c2->walls[RIGHT] = false;
+            if (x > 0) *maze_east_word(m, x - 1, y) &= ~maze_bit_mask(x - 1);
             break;
         case RIGHT:
-            c1->walls[RIGHT] = false;
-            c2->walls[LEFT] = false;
+            if (x + 1 < m->width) *maze_east_word(m, x, y) &= ~maze_bit_mask(x);
             break;
         default:
             break; // invalid enum value
@@ -219,101 +288,18 @@ void maze_remove_wall(struct Cell *c1, struct Cell *c2, enum Direction dir) {
 }
 
 
-void maze_color_start_end(const Maze *m, BmpImage *img) {
-    if (!m || !img) return;
-
-    // shorthand
-    int cs = m->cell_size, wt = m->wall_thickness;
-    int sx = m->start.x, sy = m->start.y;
-    int ex = m->end.x,   ey = m->end.y;
-
-    // Compute pixel bounds for an inset rectangle inside the walls
-    int sx0 = sx*cs + wt,  sy0 = sy*cs + wt;
-    int sx1 = (sx+1)*cs - 1 -wt, sy1 = (sy+1)*cs - 1 - wt;
-
-    // Paint start region
-    for (int y = sy0; y <= sy1; ++y) {
-        for (int x = sx0; x <= sx1; ++x) {
-            bmp_set_pixel(img, x, y, MAZE_START_COLOR);
-        }
-    }
-
-    // Compute for end cell
-    int ex0 = ex*cs + wt,  ey0 = ey*cs + wt;
-    int ex1 = (ex+1)*cs - 1 - wt, ey1 = (ey+1)*cs - 1 - wt;
-
-    // Paint end region
-    for (int y = ey0; y <= ey1; ++y) {
-        for (int x = ex0; x <= ex1; ++x) {
-            bmp_set_pixel(img, x, y, MAZE_END_COLOR);
-        }
-    }
+void maze_get_row(const struct Maze *m, size_t y, struct MazeRow *out_row) {
+    out_row->y = y;
+    out_row->width = m->width;
+    out_row->row_words = m->row_words;
+    out_row->east = maze_row_east(m, y);
+    out_row->south = maze_row_south(m, y);
 }
 
-
-void maze_render_to_bmp(struct Maze *m, BmpImage *img) {
-    if (!m || !img) return;
-
-    for (size_t y = 0; y < img->infoHeader.biHeight; ++y) {
-        for (size_t x = 0; x < img->infoHeader.biWidth; ++x) {
-            bmp_set_pixel(img, x, y, MAZE_BG_COLOR);
-        }
-    }
-
-    for (size_t cy = 0; cy < m->height; ++cy) {
-        for (size_t cx = 0; cx < m->width; ++cx) {
-            maze_render_cell(m, img, &m->cells[cy][cx]);
-        }
-    }
-
-    // Color start and end cells
-    maze_color_start_end(m, img);
+bool maze_store_row(const struct MazeRow *row, void *maze) {
+    struct Maze *m = maze;
+    if (row->y >= m->height || row->row_words != m->row_words) return false;
+    memcpy(maze_east_word(m, 0, row->y), row->east, row->row_words * sizeof(uint64_t));
+    memcpy(maze_south_word(m, 0, row->y), row->south, row->row_words * sizeof(uint64_t));
+    return true;
 }
-
-void maze_render_cell(const struct Maze *m, struct BmpImage *img, const struct Cell *cell) {
-    int cs = m->cell_size, T = m->wall_thickness;
-    int x0 = cell->position.x * cs;
-    int y0 = cell->position.y * cs;
-    int x1 = x0 + cs - 1;
-    int y1 = y0 + cs - 1;
-
-    // Fill background
-    for (int y = y0; y <= y1; ++y){
-        for (int x = x0; x <= x1; ++x) {
-            bmp_set_pixel(img, x, y, MAZE_BG_COLOR);
-        }
-    }
-    
-    // Draw each wall as a stripe of thickness T
-    if (cell->walls[UP]) {
-        for (int t = 0; t < T; ++t) {
-            for (int x = x0; x <= x1; ++x) {
-                bmp_set_pixel(img, x, y0 + t, MAZE_WALL_COLOR);
-            }
-        }
-    }
-
-    if (cell->walls[DOWN]) {
-        for (int t = 0; t < T; ++t) {
-            for (int x = x0; x <= x1; ++x) {
-                 bmp_set_pixel(img, x, y1 - t, MAZE_WALL_COLOR);
-            }
-        }
-    }
-
-    if (cell->walls[LEFT]) {
-        for (int t = 0; t < T; ++t) {
-            for (int y = y0; y <= y1; ++y) {
-                bmp_set_pixel(img, x0 + t, y, MAZE_WALL_COLOR);
-            }
-        }
-    }
-
-    if (cell->walls[RIGHT]) {
-        for (int t = 0; t < T; ++t) {
-            for (int y = y0; y <= y1; ++y) {
-                bmp_set_pixel(img, x1 - t, y, MAZE_WALL_COLOR);
-            }
-        }
-    }
-}
\ No newline at end of file
@@ -5,17 +5,14 @@
 #include <stddef.h>  // for size_t
 #include <stdint.h>  // for uint8_t
 
-#include "../bmp/bmp.h"
 #include "../stack/stack.h"
+#include "../rng/rng.h"
+#include "../threadpool/threadpool.h"
 
-extern struct RGBTriple MAZE_START_COLOR; // default {0,255,0}
-extern struct RGBTriple MAZE_END_COLOR;   // default {255,0,0}
-extern struct RGBTriple MAZE_WALL_COLOR;  // default {0,0,0}
-extern struct RGBTriple MAZE_BG_COLOR;    // default {255,255,255}
-
+// Cell coordinates; 64-bit, so positions scaled to pixels never overflow
 struct Point {
-    int32_t x;
-    int32_t y;
+    int64_t x;
+    int64_t y;
 };
 
 enum Direction {
@@ -25,10 +22,80 @@ enum Direction {
     LEFT = 3
 };
 
-struct Cell {
-    struct Point position; // pixel coordinates of the cell
-    bool visited; // true if the cell has been visited
-    bool walls[4]; // {UP | RIGHT | DOWN | LEFT}
+// Wall grid layout
+// -----------------
+// Only the east and south wall of every cell is stored, as one bit each, so
+// every interior wall exists exactly once. The west wall of column 0 and the
+// north wall of row 0 are the outer border and are implicit. Each cell row
+// occupies 2 * row_words 64-bit words: row_words words of east bits followed
+// by row_words words of south bits, bit (x & 63) of word (x >> 6) belonging to
+// column x. Bits past the last column are always zero. Cells are addressed by
+// their index y * width + x; positions are derived from it on demand. Cell
+// indices fit in 32 bits, so a maze holds at most UINT32_MAX cells.
+
+enum MazeAlgorithm {
+    MAZE_ALGO_DFS = 0,   // Depth-first search over the whole grid
+    MAZE_ALGO_ELLER = 1, // Eller's algorithm, streamed row by row
+    MAZE_ALGO_TILED = 2, // Parallel DFS per tile, tiles joined by a spanning tree
+    MAZE_ALGO_KRUSKAL = 3, // Randomized Kruskal over a parallel-shuffled wall list
+    MAZE_ALGO_KRUSKAL_PARALLEL = 4, // Kruskal with a lock-free union-find shared by all workers
+    MAZE_ALGO_DFS_BLOCKED = 5, // The DFS maze, carved on a cache-friendly 8x8-block layout
+    MAZE_ALGO_BINARY_TREE = 6, // Every cell opens east or south on a coin flip; rows in parallel
+    MAZE_ALGO_SIDEWINDER = 7, // Rows of east-west runs, each opening south once; rows in parallel
+    MAZE_ALGO_GROWING_NEWEST = 8, // Growing tree from the newest cell: the DFS maze's texture, with no stack
+    MAZE_ALGO_GROWING_RANDOM = 9, // Growing tree from a random cell: Prim-like, short dead ends
+    MAZE_ALGO_GROWING_OLDEST = 10, // Growing tree from the oldest cell: long straight corridors from the start
+    MAZE_ALGO_GROWING_MIXED = 11 // Growing tree from the newest or a random cell, at MazeGenContext.newest_percent
+};
+
+// Cell a growing tree grows from next, among those that may still have unvisited neighbors
+enum MazeGrowPolicy {
+    MAZE_GROW_NEWEST = 0,
+    MAZE_GROW_RANDOM = 1,
+    MAZE_GROW_OLDEST = 2,
+    MAZE_GROW_MIXED = 3 // Newest in newest_percent of the steps, random in the rest
+};
+
+#define MAZE_GROW_NEWEST_PERCENT 50 // Default MazeGenContext.newest_percent
+
+// Generator registry
+// ------------------
+// Every algorithm that fills a whole grid is one MazeGenerator: its id and
+// name plus init, generate and free functions that share a MazeGenContext.
+// init sets up the engine's own state for ctx->m, generate carves the maze
+// and free releases the state; an engine without state has no init or free.
+// maze_generator_run does all three, so callers pick an algorithm by id or
+// name and never name its entry point.
+struct MazeGenContext {
+    struct Maze *m;
+    struct Rng *rng;
+    struct ThreadPool *pool; // NULL = single-threaded
+    uint32_t newest_percent; // MAZE_GROW_MIXED: share of steps, 0-100, that grow from the newest cell
+    void *state; // The engine's, from init to free
+};
+
+struct MazeGenerator {
+    enum MazeAlgorithm algorithm;
+    const char *name; // Short name, as given to --algo
+    const char *function; // Entry point, for messages
+    bool (*init)(struct MazeGenContext *ctx); // NULL if the engine keeps no state
+    bool (*generate)(struct MazeGenContext *ctx);
+    void (*free)(struct MazeGenContext *ctx); // NULL if the engine keeps no state
+};
+
+// Tile size of maze_generate_tiled. The width is a multiple of 64 cells, so
+// tiles never share a 64-bit word of wall or visited bits and workers write
+// them without atomics. Rows are neither padded nor cache-line aligned, so
+// tiles side by side may still share a cache line where they meet.
+#define MAZE_TILE_WIDTH 512
+#define MAZE_TILE_HEIGHT 128
+
+// Half-open rectangle of cells [x0, x1) x [y0, y1)
+struct MazeRegion {
+    size_t x0;
+    size_t y0;
+    size_t x1;
+    size_t y1;
 };
 
 struct Maze {
@@ -38,25 +105,126 @@ struct Maze {
     struct Point start; // starting cell coords
     struct Point end; // ending cell coords
     uint32_t wall_thickness; // pixel thickness of walls (e.g. 1 for 1 px)
-    struct Cell **cells; // 2D array [row][col]
+    size_t row_words; // 64-bit words per bit row, (width + 63) / 64
+    uint64_t *walls; // east/south wall bits, 2 * row_words words per cell row
+    uint64_t *visited; // visited bits, row_words words per cell row
+    size_t capacity; // Bit rows' worth of words allocated: walls holds 2 * capacity words, visited capacity
+    struct Stack *stack; // DFS work stack of 32-bit cell indices, reused across generate cycles
+    void *file; // .maze file mapping that walls points into, NULL if walls is allocated
+    size_t file_size; // in bytes
+};
+
+static inline size_t maze_cell_index(const struct Maze *m, size_t x, size_t y) { return y * m->width + x; } // Index of the cell at (x, y)
+
+static inline const uint64_t *maze_row_east(const struct Maze *m, size_t y) { return m->walls + y * 2 * m->row_words; } // East wall bits of cell row y
+
+static inline const uint64_t *maze_row_south(const struct Maze *m, size_t y) { return m->walls + y * 2 * m->row_words + m->row_words; } // South wall bits of cell row y
+
+static inline uint64_t *maze_east_word(const struct Maze *m, size_t x, size_t y) { return m->walls + y * 2 * m->row_words + (x >> 6); } // Word holding the east wall bit of (x, y)
+
+static inline uint64_t *maze_south_word(const struct Maze *m, size_t x, size_t y) { return m->walls + y * 2 * m->row_words + m->row_words + (x >> 6); } // Word holding the south wall bit of (x, y)
+
+static inline uint64_t *maze_visited_word(const struct Maze *m, size_t x, size_t y) { return m->visited + y * m->row_words + (x >> 6); } // Word holding the visited bit of (x, y)
+
+static inline uint64_t maze_bit_mask(size_t x) { return (uint64_t)1 << (x & 63); } // Mask of column x's bit within its word
+
+// .maze files
+// -----------
+// A 64-byte header (magic, version, dimensions, start, end, seed, algorithm,
+// row_words) followed by the wall rows in the grid layout above. Loading maps
+// the file and uses the rows in place as the wall grid, so it costs the same
+// for any maze size.
+#define MAZE_FILE_VERSION 1
+
+// Provenance stored in a .maze file next to the grid
+struct MazeFileInfo {
+    uint64_t seed; // Seed the maze was generated from
+    enum MazeAlgorithm algorithm; // Algorithm that generated it
 };
 
+// One finished cell row, laid out like a row of the wall grid
+struct MazeRow {
+    size_t y; // cell row index
+    size_t width; // in cells
+    size_t row_words; // 64-bit words per bit row
+    const uint64_t *east; // east wall bits of the row
+    const uint64_t *south; // south wall bits of the row (all set on the last row)
+};
+
+typedef bool (*MazeRowCallback)(const struct MazeRow *row, void *user); // Receives each finished row in order; return false to stop
+
 struct Maze* maze_create(size_t width, size_t height, uint32_t cell_size, struct Point start, struct Point end, uint32_t wall_thickness); // Allocate and initialize a new Maze (all walls present, unvisited)
 
+bool maze_reshape(struct Maze *m, size_t width, size_t height, uint32_t cell_size, struct Point start, struct Point end, uint32_t wall_thickness); // Give a maze new dimensions and endpoints, reusing its storage when large enough, and reset it; false (maze unchanged) if invalid
+
 void maze_free(struct Maze *m); // Free all memory associated with a Maze
 
 void maze_reset(struct Maze *m); // Reset maze state: mark all cells unvisited and restore all walls
 
-void maze_generate_dfs(struct Maze *m); // Generate the maze using Depth-First Search (recursive backtracking)
+bool maze_generate_dfs(struct Maze *m, struct Rng *rng); // Generate the maze using Depth-First Search (recursive backtracking), drawing from rng; false if out of memory
+
+bool maze_generate_dfs_blocked(struct Maze *m, struct Rng *rng); // Generate the maze_generate_dfs maze for the same rng, carving on a copy of the grid in 8x8-cell blocks that is converted back to rows at the end; faster on grids far larger than the caches
+
+bool maze_generate_dfs_region(struct Maze *m, struct Rng *rng, struct Stack *stack, const struct MazeRegion *region, size_t start_cell); // Carve a DFS spanning tree over the unvisited cells of a region from start_cell, never opening the region's border
+
+bool maze_generate_tiled(struct Maze *m, struct Rng *rng, struct ThreadPool *pool); // Generate with one DFS per tile on the pool's workers, then join the tiles along a random spanning tree; deterministic for a given seed whatever the thread count
+
+bool maze_generate_kruskal(struct Maze *m, struct Rng *rng, struct ThreadPool *pool); // Generate with randomized Kruskal: walls shuffled on the pool (NULL = single-threaded), joined by a union-find with path compression and union by rank
+
+bool maze_generate_kruskal_parallel(struct Maze *m, struct Rng *rng, struct ThreadPool *pool); // Kruskal whose wall batches are joined concurrently through a lock-free CAS union-find; the result varies with thread scheduling
+
+bool maze_generate_binary_tree(struct Maze *m, struct Rng *rng, struct ThreadPool *pool); // Binary tree: each cell opens its east or south wall at random, 64 cells per draw, rows in parallel on the pool (NULL = single-threaded); deterministic for a given seed whatever the thread count
+
+bool maze_generate_sidewinder(struct Maze *m, struct Rng *rng, struct ThreadPool *pool); // Sidewinder: each row splits into random east-west runs that each open one random south wall, rows in parallel on the pool (NULL = single-threaded); deterministic for a given seed whatever the thread count
+
+bool maze_growing_tree_init(struct MazeGenContext *ctx); // Allocate the growing tree's list of cells, one 32-bit index per cell of ctx->m
+
+bool maze_generate_growing_tree(struct MazeGenContext *ctx, enum MazeGrowPolicy policy); // Grow a spanning tree from the start cell, each step from the listed cell the policy picks; needs maze_growing_tree_init
+
+void maze_growing_tree_free(struct MazeGenContext *ctx); // Free the list of maze_growing_tree_init
+
+bool maze_generate_eller(size_t width, size_t height, struct Rng *rng, MazeRowCallback emit, void *user); // Generate a maze row by row with Eller's algorithm in O(width) memory, handing each row to emit
+
+bool maze_regenerate_region(struct Maze *m, struct Rng *rng, const struct MazeRegion *region); // Carve the cells of a region of a perfect maze afresh, keeping it perfect: the openings in the region's border and the passages joining them inside it stay; touches only the region, in O(region cells)
+
+bool maze_save(const struct Maze *m, const char *filename, const struct MazeFileInfo *info); // Write the maze grid as a .maze file
+
+bool maze_save_region(const struct Maze *m, const char *filename, const struct MazeRegion *region); // Rewrite in place, in a .maze file of m, only the wall words of the region's rows, e.g. after maze_regenerate_region
+
+struct Maze *maze_load(const char *filename, uint32_t cell_size, uint32_t wall_thickness, struct MazeFileInfo *out_info); // Map a .maze file privately and use its rows as the wall grid (out_info may be NULL); NULL if missing or malformed
+
+struct MazeFileWriter *maze_file_writer_open(const char *filename, size_t width, size_t height, struct Point start, struct Point end, const struct MazeFileInfo *info); // Start a .maze file whose rows arrive one at a time
+
+bool maze_file_writer_row(const struct MazeRow *row, void *user); // MazeRowCallback appending the next row to a MazeFileWriter
+
+bool maze_file_writer_close(struct MazeFileWriter *w); // Finish the file; false if a write failed or rows are missing
+
+const struct MazeGenerator *maze_generators(size_t *out_count); // All registered generators, in algorithm id order
+
+const struct MazeGenerator *maze_generator_find(enum MazeAlgorithm algo); // Registered generator of an algorithm, NULL if none
+
+bool maze_generator_run(const struct MazeGenerator *g, struct MazeGenContext *ctx); // Init, generate and free on ctx; false if any step fails
+
+const char *maze_algorithm_name(enum MazeAlgorithm algo); // Short name of an algorithm ("dfs", "eller", "tiled", "kruskal", "kruskal-mt", "dfs-blocked", "binary-tree", "sidewinder", "growing-newest", "growing-random", "growing-oldest", "growing-mixed")
+
+bool maze_algorithm_from_name(const char *name, enum MazeAlgorithm *out_algo); // Look up an algorithm by its short name
+
+void maze_get_row(const struct Maze *m, size_t y, struct MazeRow *out_row); // Describe cell row y of the grid as a MazeRow
+
+bool maze_store_row(const struct MazeRow *row, void *maze); // MazeRowCallback copying a row into the grid of the Maze passed as user, e.g. to keep Eller rows
+
+struct Point maze_cell_position(const struct Maze *m, size_t cell); // Cell coordinates of a cell index
+
+bool maze_is_visited(const struct Maze *m, size_t cell); // Check whether a cell has been visited
 
-bool maze_has_unvisited_neighbor(const struct Maze *m, const struct Cell *c, enum Direction *out_dir); // Check if a cell has at least one unvisited neighbor
+void maze_set_visited(struct Maze *m, size_t cell); // Mark a cell as visited
 
-struct Cell* maze_get_neighbor(const struct Maze *m, const struct Cell *c, enum Direction dir); // Get pointer to the neighboring cell in the given direction, or NULL if out of bounds
+bool maze_has_wall(const struct Maze *m, size_t cell, enum Direction dir); // Check whether the wall on the given side of a cell is present
 
-void maze_remove_wall(struct Cell *c1, struct Cell *c2, enum Direction dir); // Remove the wall between two neighboring cells
+bool maze_has_unvisited_neighbor(const struct Maze *m, size_t cell, struct Rng *rng, enum Direction *out_dir); // Check if a cell has at least one unvisited neighbor and pick one of them uniformly at random
 
-void maze_render_to_bmp(struct Maze *m, struct BmpImage*); // Draw the maze to a BMP file
+bool maze_get_neighbor(const struct Maze *m, size_t cell, enum Direction dir, size_t *out_neighbor); // Get the index of the neighboring cell in the given direction, false if out of bounds
 
-void maze_render_cell(const struct Maze *m, struct BmpImage *img, const struct Cell *cell); // Draw a cell at its pixel coordinates
+void maze_remove_wall(struct Maze *m, size_t cell, enum Direction dir); // Remove the wall between a cell and its neighbor in the given direction
 
 #endif // MAZE_GENERATOR_H
\ No newline at end of file
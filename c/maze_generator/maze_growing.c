@@ -0,0 +1,115 @@
+#include "maze_generator.h"
+#include "../maze_stats/maze_stats.h"
+
+#include <stdlib.h> // for malloc, free
+
+typedef struct Maze Maze;
+typedef struct MazeGenContext MazeGenContext;
+typedef struct Rng Rng;
+typedef enum Direction Direction;
+
+// Growing tree
+// ------------
+// A list holds the visited cells that may still have unvisited neighbors.
+// Each step takes one of them, chosen by the policy, and carves into a random
+// unvisited neighbor, which joins the list; a cell with none left leaves it.
+// Taking the newest cell is the DFS, taking a random one carves like Prim's
+// algorithm, and the oldest one gives long corridors out of the start.
+//
+// Every cell joins the list once, so the list is a flat array of one 32-bit
+// index per cell that is filled from the front: live cells are [head, tail).
+// The newest leaves by tail--, the oldest by head++, and any other cell by
+// taking the oldest's place. That keeps the order among the newer cells, the
+// only order MAZE_GROW_MIXED looks at.
+struct GrowList {
+    uint32_t *cells;
+    size_t capacity; // in cells
+};
+
+// The unvisited neighbors of (x, y), one of them picked uniformly; false if none
+static bool pick_unvisited(const Maze *m, size_t x, size_t y, Rng *rng, Direction *out_dir) {
+    Direction candidates[4];
+    uint32_t n = 0;
+
+    if (y > 0 && !(*maze_visited_word(m, x, y - 1) & maze_bit_mask(x))) candidates[n++] = UP;
+    if (x + 1 < m->width && !(*maze_visited_word(m, x + 1, y) & maze_bit_mask(x + 1))) candidates[n++] = RIGHT;
+    if (y + 1 < m->height && !(*maze_visited_word(m, x, y + 1) & maze_bit_mask(x))) candidates[n++] = DOWN;
+    if (x > 0 && !(*maze_visited_word(m, x - 1, y) & maze_bit_mask(x - 1))) candidates[n++] = LEFT;
+    MAZE_STAT_ADD(visited_probes, (y > 0) + (x + 1 < m->width) + (y + 1 < m->height) + (x > 0) - n);
+
+    if (n == 0) return false;
+    *out_dir = n == 1 ? candidates[0] : candidates[rng_bounded(rng, n)];
+    return true;
+}
+
+bool maze_growing_tree_init(struct MazeGenContext *ctx) {
+    if (!ctx || !ctx->m) return false;
+
+    struct GrowList *list = malloc(sizeof *list);
+    if (!list) return false;
+    list->capacity = ctx->m->width * ctx->m->height;
+    list->cells = malloc(list->capacity * sizeof(uint32_t));
+    if (!list->cells) {
+        free(list);
+        return false;
+    }
+    ctx->state = list;
+    return true;
+}
+
+void maze_growing_tree_free(struct MazeGenContext *ctx) {
+    if (!ctx || !ctx->state) return;
+    struct GrowList *list = ctx->state;
+    free(list->cells);
+    free(list);
+    ctx->state = NULL;
+}
+
+bool maze_generate_growing_tree(struct MazeGenContext *ctx, enum MazeGrowPolicy policy) {
+    if (!ctx || !ctx->m || !ctx->m->walls || !ctx->rng || !ctx->state) return false;
+    Maze *m = ctx->m;
+    Rng *rng = ctx->rng;
+    const struct GrowList *list = ctx->state;
+    if (list->capacity < m->width * m->height) return false; // Initialized for a smaller maze
+
+    maze_reset(m);
+
+    uint32_t *cells = list->cells;
+    size_t head = 0, tail = 0;
+    size_t sx = (size_t)m->start.x, sy = (size_t)m->start.y;
+    *maze_visited_word(m, sx, sy) |= maze_bit_mask(sx);
+    cells[tail++] = (uint32_t)maze_cell_index(m, sx, sy);
+
+    while (head < tail) {
+        size_t i;
+        switch (policy) {
+            case MAZE_GROW_OLDEST: i = head; break;
+            case MAZE_GROW_RANDOM: i = head + rng_bounded(rng, (uint32_t)(tail - head)); break;
+            case MAZE_GROW_MIXED:
+                i = rng_bounded(rng, 100) < ctx->newest_percent ? tail - 1 : head + rng_bounded(rng, (uint32_t)(tail - head));
+                break;
+            default: i = tail - 1; break;
+        }
+
+        size_t x = cells[i] % m->width, y = cells[i] / m->width;
+        Direction dir;
+        if (pick_unvisited(m, x, y, rng, &dir)) {
+            size_t nx = x, ny = y;
+            switch (dir) {
+                case UP:    ny = y - 1; *maze_south_word(m, nx, ny) &= ~maze_bit_mask(nx); break;
+                case DOWN:  ny = y + 1; *maze_south_word(m, x, y) &= ~maze_bit_mask(x); break;
+                case LEFT:  nx = x - 1; *maze_east_word(m, nx, ny) &= ~maze_bit_mask(nx); break;
+                case RIGHT: nx = x + 1; *maze_east_word(m, x, y) &= ~maze_bit_mask(x); break;
+            }
+            *maze_visited_word(m, nx, ny) |= maze_bit_mask(nx);
+            cells[tail++] = (uint32_t)maze_cell_index(m, nx, ny);
+        } else if (i + 1 == tail) {
+            tail--;
+            MAZE_STAT_ADD(backtracks, 1);
+        } else {
+            cells[i] = cells[head++];
+            MAZE_STAT_ADD(backtracks, 1);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,299 @@
+#include "maze_generator.h"
+
+#include <stdatomic.h> // for atomic_bool, atomic_size_t
+#include <stdlib.h> // for malloc, calloc, free
+
+typedef struct Maze Maze;
+typedef struct Rng Rng;
+typedef struct ThreadPool ThreadPool;
+
+// Interior walls are identified as cell * 2 + 0 (east) or + 1 (south)
+#define WALL_EAST 0
+#define WALL_SOUTH 1
+
+#define SHUFFLE_CHUNK_CELLS (1u << 18) // Cells enumerated per shuffle task
+#define SHUFFLE_MAX_BUCKETS 256 // Upper bound on the buckets of the parallel shuffle
+#define UNION_BLOCK 4096 // Walls per task of the concurrent union pass
+
+// Parallel shuffle of all interior walls (Rao-Sandelius): every wall is sent
+// to a uniformly random bucket, the buckets are laid out back to back and
+// each one is Fisher-Yates shuffled. Every step draws from a stream tied to
+// its chunk or bucket, so the permutation does not depend on the threads.
+struct Shuffle {
+    const Maze *m;
+    uint64_t seed;
+    size_t n_chunks;
+    uint32_t n_buckets;
+    size_t *offsets; // [chunk][bucket] counts, then write positions
+    size_t *bucket_start; // n_buckets + 1 bucket boundaries
+    uint32_t *walls;
+};
+
+// Run body with id set to each interior wall of the cells in chunk k
+#define FOR_EACH_WALL(m, k, id, body)                                              \
+    do {                                                                           \
+        size_t c0_ = (k) * SHUFFLE_CHUNK_CELLS;                                    \
+        size_t c1_ = c0_ + SHUFFLE_CHUNK_CELLS;                                    \
+        size_t n_ = (m)->width * (m)->height;                                       \
+        if (c1_ > n_) c1_ = n_;                                                    \
+        size_t x_ = c0_ % (m)->width, y_ = c0_ / (m)->width;                        \
+        for (size_t c_ = c0_; c_ < c1_; ++c_) {                                    \
+            if (x_ + 1 < (m)->width) { uint32_t id = (uint32_t)(c_ * 2 + WALL_EAST); body } \
+            if (y_ + 1 < (m)->height) { uint32_t id = (uint32_t)(c_ * 2 + WALL_SOUTH); body } \
+            if (++x_ == (m)->width) { x_ = 0; ++y_; }                               \
+        }                                                                          \
+    } while (0)
+
+static void shuffle_count(void *ctx, size_t k, unsigned worker) {
+    (void)worker;
+    struct Shuffle *sh = ctx;
+    size_t *counts = sh->offsets + k * sh->n_buckets;
+    Rng rng;
+    rng_seed_stream(&rng, sh->seed, k);
+    FOR_EACH_WALL(sh->m, k, id, { (void)id; counts[rng_bounded(&rng, sh->n_buckets)]++; });
+}
+
+static void shuffle_scatter(void *ctx, size_t k, unsigned worker) {
+    (void)worker;
+    struct Shuffle *sh = ctx;
+    size_t *pos = sh->offsets + k * sh->n_buckets;
+    Rng rng;
+    rng_seed_stream(&rng, sh->seed, k); // Replays the bucket choices of shuffle_count
+    FOR_EACH_WALL(sh->m, k, id, { sh->walls[pos[rng_bounded(&rng, sh->n_buckets)]++] = id; });
+}
+
+static void shuffle_bucket(void *ctx, size_t b, unsigned worker) {
+    (void)worker;
+    struct Shuffle *sh = ctx;
+    uint32_t *w = sh->walls + sh->bucket_start[b];
+    size_t n = sh->bucket_start[b + 1] - sh->bucket_start[b];
+    Rng rng;
+    rng_seed_stream(&rng, sh->seed, sh->n_chunks + b);
+    for (size_t i = n; i > 1; --i) {
+        size_t j = rng_bounded(&rng, (uint32_t)i);
+        uint32_t t = w[i - 1];
+        w[i - 1] = w[j];
+        w[j] = t;
+    }
+}
+
+// Randomly ordered array of all interior walls, or NULL if out of memory
+static uint32_t *shuffled_walls(const Maze *m, Rng *rng, ThreadPool *pool, size_t *out_count) {
+    size_t n_walls = (m->width - 1) * m->height + m->width * (m->height - 1);
+    *out_count = n_walls;
+
+    struct Shuffle sh;
+    sh.m = m;
+    sh.seed = rng_next(rng);
+    sh.n_chunks = (m->width * m->height + SHUFFLE_CHUNK_CELLS - 1) / SHUFFLE_CHUNK_CELLS;
+    sh.n_buckets = (uint32_t)(n_walls >> 16 < SHUFFLE_MAX_BUCKETS ? (n_walls >> 16) + 1 : SHUFFLE_MAX_BUCKETS);
+    sh.offsets = calloc(sh.n_chunks * sh.n_buckets, sizeof(size_t));
+    sh.bucket_start = malloc((sh.n_buckets + 1) * sizeof(size_t));
+    sh.walls = malloc((n_walls ? n_walls : 1) * sizeof(uint32_t));
+    if (!sh.offsets || !sh.bucket_start || !sh.walls) {
+        free(sh.offsets);
+        free(sh.bucket_start);
+        free(sh.walls);
+        return NULL;
+    }
+
+    threadpool_run(pool, sh.n_chunks, shuffle_count, &sh);
+
+    // Turn the per-chunk counts into write positions, bucket by bucket
+    size_t pos = 0;
+    for (uint32_t b = 0; b < sh.n_buckets; ++b) {
+        sh.bucket_start[b] = pos;
+        for (size_t k = 0; k < sh.n_chunks; ++k) {
+            size_t count = sh.offsets[k * sh.n_buckets + b];
+            sh.offsets[k * sh.n_buckets + b] = pos;
+            pos += count;
+        }
+    }
+    sh.bucket_start[sh.n_buckets] = pos;
+
+    threadpool_run(pool, sh.n_chunks, shuffle_scatter, &sh);
+    threadpool_run(pool, sh.n_buckets, shuffle_bucket, &sh);
+
+    free(sh.offsets);
+    free(sh.bucket_start);
+    return sh.walls;
+}
+
+// Cells on either side of a wall
+static inline void wall_cells(const Maze *m, uint32_t wall, size_t *a, size_t *b) {
+    *a = wall >> 1;
+    *b = (wall & 1) == WALL_EAST ? *a + 1 : *a + m->width;
+}
+
+static inline uint64_t *wall_word(const Maze *m, uint32_t wall, uint64_t *mask) {
+    size_t cell = wall >> 1, x = cell % m->width, y = cell / m->width;
+    *mask = maze_bit_mask(x);
+    return (wall & 1) == WALL_EAST ? maze_east_word(m, x, y) : maze_south_word(m, x, y);
+}
+
+static bool kruskal_supported(const Maze *m) {
+    return m && m->walls && m->width * m->height <= UINT32_MAX / 2;
+}
+
+// Root of a set with path halving
+static inline uint32_t dsu_find(uint32_t *parent, uint32_t x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+bool maze_generate_kruskal(Maze *m, Rng *rng, ThreadPool *pool) {
+    if (!kruskal_supported(m) || !rng) return false;
+
+    maze_reset(m);
+
+    size_t n_cells = m->width * m->height, n_walls;
+    uint32_t *walls = shuffled_walls(m, rng, pool, &n_walls);
+    uint32_t *parent = malloc(n_cells * sizeof(uint32_t));
+    uint8_t *rank = calloc(n_cells, 1);
+    if (!walls || !parent || !rank) {
+        free(walls);
+        free(parent);
+        free(rank);
+        return false;
+    }
+
+    for (size_t c = 0; c < n_cells; ++c) {
+        parent[c] = (uint32_t)c;
+    }
+
+    // Open every wall that joins two different trees, by union by rank
+    size_t joined = 0;
+    for (size_t i = 0; i < n_walls && joined + 1 < n_cells; ++i) {
+        size_t a, b;
+        wall_cells(m, walls[i], &a, &b);
+        uint32_t ra = dsu_find(parent, (uint32_t)a);
+        uint32_t rb = dsu_find(parent, (uint32_t)b);
+        if (ra == rb) continue;
+
+        if (rank[ra] < rank[rb]) {
+            parent[ra] = rb;
+        } else {
+            parent[rb] = ra;
+            if (rank[ra] == rank[rb]) rank[ra]++;
+        }
+        uint64_t mask;
+        *wall_word(m, walls[i], &mask) &= ~mask;
+        joined++;
+    }
+
+    free(walls);
+    free(parent);
+    free(rank);
+    return true;
+}
+
+// Lock-free union-find. Roots are linked by a fixed pseudo-random priority
+// (a bijective hash of the index), which keeps trees shallow like union by
+// rank without a second word to update atomically.
+struct ConcurrentKruskal {
+    const Maze *m;
+    const uint32_t *walls;
+    size_t n_walls;
+    uint32_t *parent;
+    atomic_size_t joined; // Successful unions so far
+    size_t target; // n_cells - 1
+};
+
+static inline uint32_t link_priority(uint32_t x) {
+    x *= 0x9E3779B1u;
+    return x ^ (x >> 16);
+}
+
+static inline uint32_t cas_find(uint32_t *parent, uint32_t x) {
+    for (;;) {
+        uint32_t p = __atomic_load_n(&parent[x], __ATOMIC_ACQUIRE);
+        if (p == x) return x;
+        uint32_t gp = __atomic_load_n(&parent[p], __ATOMIC_ACQUIRE);
+        if (p != gp) {
+            // Path halving; losing the race only means less compression
+            __atomic_compare_exchange_n(&parent[x], &p, gp, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        }
+        x = gp;
+    }
+}
+
+// Link the roots of a and b; false if they were already in the same set
+static inline bool cas_unite(uint32_t *parent, uint32_t a, uint32_t b) {
+    for (;;) {
+        a = cas_find(parent, a);
+        b = cas_find(parent, b);
+        if (a == b) return false;
+        if (link_priority(a) > link_priority(b)) {
+            uint32_t t = a;
+            a = b;
+            b = t;
+        }
+        uint32_t expected = a;
+        if (__atomic_compare_exchange_n(&parent[a], &expected, b, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            return true; // a was still a root and now hangs below b
+        }
+    }
+}
+
+static void union_block(void *ctx, size_t block, unsigned worker) {
+    (void)worker;
+    struct ConcurrentKruskal *ck = ctx;
+    size_t i0 = block * UNION_BLOCK;
+    size_t i1 = i0 + UNION_BLOCK < ck->n_walls ? i0 + UNION_BLOCK : ck->n_walls;
+    if (atomic_load_explicit(&ck->joined, memory_order_relaxed) >= ck->target) return;
+
+    for (size_t i = i0; i < i1; ++i) {
+        size_t a, b;
+        wall_cells(ck->m, ck->walls[i], &a, &b);
+        if (cas_unite(ck->parent, (uint32_t)a, (uint32_t)b)) {
+            // Neighbouring walls share words, so clear the bit atomically
+            uint64_t mask;
+            uint64_t *word = wall_word(ck->m, ck->walls[i], &mask);
+            __atomic_fetch_and(word, ~mask, __ATOMIC_RELAXED);
+            atomic_fetch_add_explicit(&ck->joined, 1, memory_order_relaxed);
+        }
+    }
+}
+
+static void init_parents(void *ctx, size_t block, unsigned worker) {
+    (void)worker;
+    struct ConcurrentKruskal *ck = ctx;
+    size_t n_cells = ck->target + 1;
+    size_t c0 = block * SHUFFLE_CHUNK_CELLS;
+    size_t c1 = c0 + SHUFFLE_CHUNK_CELLS < n_cells ? c0 + SHUFFLE_CHUNK_CELLS : n_cells;
+    for (size_t c = c0; c < c1; ++c) {
+        ck->parent[c] = (uint32_t)c;
+    }
+}
+
+bool maze_generate_kruskal_parallel(Maze *m, Rng *rng, ThreadPool *pool) {
+    if (!kruskal_supported(m) || !rng) return false;
+
+    maze_reset(m);
+
+    size_t n_cells = m->width * m->height, n_walls;
+    struct ConcurrentKruskal ck;
+    ck.m = m;
+    ck.walls = shuffled_walls(m, rng, pool, &n_walls);
+    ck.n_walls = n_walls;
+    ck.parent = malloc(n_cells * sizeof(uint32_t));
+    ck.target = n_cells - 1;
+    atomic_init(&ck.joined, 0);
+    if (!ck.walls || !ck.parent) {
+        free((void *)ck.walls);
+        free(ck.parent);
+        return false;
+    }
+
+    // Blocks are handed out in order, so walls are still taken roughly in
+    // the shuffled order; only walls racing in flight can swap places
+    threadpool_run(pool, (n_cells + SHUFFLE_CHUNK_CELLS - 1) / SHUFFLE_CHUNK_CELLS, init_parents, &ck);
+    threadpool_run(pool, (n_walls + UNION_BLOCK - 1) / UNION_BLOCK, union_block, &ck);
+
+    free((void *)ck.walls);
+    free(ck.parent);
+    return true;
+}
@@ -0,0 +1,168 @@
+#include "maze_generator.h"
+
+#include <stdlib.h> // for malloc, calloc, free
+
+typedef struct Maze Maze;
+typedef struct MazeRegion MazeRegion;
+typedef struct Rng Rng;
+
+#define NO_PARENT UINT32_MAX
+
+// Re-rolling a region
+// -------------------
+// A perfect maze is a spanning tree of its cells. Take a region out and the
+// rest of the tree falls apart into pieces, each reaching the region through
+// one or more openings in its border; the passages inside the region are what
+// held those pieces together. Which openings lead to the same outside piece
+// cannot be told from inside the region, since the pieces may run anywhere in
+// the rest of the maze. So the openings are all kept, and so is the way the
+// old passages grouped them: for each old inside tree, the part of it that
+// spans its openings stays, and every other cell of the region is carved
+// afresh by DFS growing out of those kept passages. A new cell joins exactly
+// one kept tree, so the maze is a spanning tree again, and no cell outside the
+// region is read past its border or written.
+struct RegionScratch {
+    size_t width; // Region width in cells; cells are numbered locally, row by row
+    uint32_t *parent; // Parent in the old inside tree (a root is its own), NO_PARENT until reached
+    uint32_t *queue; // Cells in BFS order
+    uint8_t *keep; // On a kept passage
+};
+
+static inline bool east_open(const Maze *m, size_t x, size_t y) {
+    return !(*maze_east_word(m, x, y) & maze_bit_mask(x));
+}
+
+static inline bool south_open(const Maze *m, size_t x, size_t y) {
+    return !(*maze_south_word(m, x, y) & maze_bit_mask(x));
+}
+
+// The cell has a passage through the region's border
+static bool is_opening(const Maze *m, const MazeRegion *r, size_t x, size_t y) {
+    return (y == r->y0 && y > 0 && south_open(m, x, y - 1)) ||
+           (x + 1 == r->x1 && x + 1 < m->width && east_open(m, x, y)) ||
+           (y + 1 == r->y1 && y + 1 < m->height && south_open(m, x, y)) ||
+           (x == r->x0 && x > 0 && east_open(m, x - 1, y));
+}
+
+// Step to the next cell of the region's border, row by row; x1 when a row is done
+static inline size_t next_border_x(const MazeRegion *r, size_t x, size_t y) {
+    bool edge_row = y == r->y0 || y + 1 == r->y1;
+    return edge_row || x + 1 == r->x1 ? x + 1 : r->x1 - 1;
+}
+
+// Label the old inside tree of an opening cell by BFS over the passages
+// between region cells, rooted at that cell
+static void label_tree(const Maze *m, const MazeRegion *r, struct RegionScratch *s, uint32_t root, size_t *tail) {
+    size_t head = *tail;
+    s->parent[root] = root;
+    s->keep[root] = 1;
+    s->queue[(*tail)++] = root;
+
+    while (head < *tail) {
+        uint32_t i = s->queue[head++];
+        size_t x = r->x0 + i % s->width, y = r->y0 + i / s->width;
+        uint32_t next[4];
+        int n = 0;
+        if (y > r->y0 && south_open(m, x, y - 1)) next[n++] = i - (uint32_t)s->width;
+        if (x + 1 < r->x1 && east_open(m, x, y)) next[n++] = i + 1;
+        if (y + 1 < r->y1 && south_open(m, x, y)) next[n++] = i + (uint32_t)s->width;
+        if (x > r->x0 && east_open(m, x - 1, y)) next[n++] = i - 1;
+        for (int k = 0; k < n; ++k) {
+            if (s->parent[next[k]] != NO_PARENT) continue;
+            s->parent[next[k]] = i;
+            s->queue[(*tail)++] = next[k];
+        }
+    }
+}
+
+// Set or clear bits [from, to) of a bit row
+static void fill_bits(uint64_t *bits, size_t from, size_t to, bool on) {
+    for (size_t x = from; x < to;) {
+        size_t end = (x | 63) + 1 < to ? (x | 63) + 1 : to;
+        uint64_t mask = (end - (x & ~(size_t)63) == 64 ? ~(uint64_t)0 : maze_bit_mask(end) - 1) & ~(maze_bit_mask(x) - 1);
+        if (on) bits[x >> 6] |= mask;
+        else bits[x >> 6] &= ~mask;
+        x = end;
+    }
+}
+
+bool maze_regenerate_region(struct Maze *m, struct Rng *rng, const struct MazeRegion *region) {
+    if (!m || !m->walls || !rng || !region) return false;
+    const MazeRegion *r = region;
+    if (r->x0 >= r->x1 || r->y0 >= r->y1 || r->x1 > m->width || r->y1 > m->height) return false;
+
+    if (!m->stack) {
+        m->stack = createStack(-1); // -1 for unlimited capacity
+        if (!m->stack) return false;
+    }
+
+    size_t n = (r->x1 - r->x0) * (r->y1 - r->y0);
+    struct RegionScratch s = { r->x1 - r->x0, malloc(n * sizeof(uint32_t)), malloc(n * sizeof(uint32_t)), calloc(n, 1) };
+    bool ok = s.parent && s.queue && s.keep;
+
+    if (ok) {
+        // 1) The old inside trees of the openings, each rooted at its first opening
+        for (size_t i = 0; i < n; ++i) s.parent[i] = NO_PARENT;
+        size_t tail = 0;
+        for (size_t y = r->y0; y < r->y1; ++y) {
+            for (size_t x = r->x0; x < r->x1; x = next_border_x(r, x, y)) {
+                uint32_t i = (uint32_t)((y - r->y0) * s.width + (x - r->x0));
+                if (s.parent[i] == NO_PARENT && is_opening(m, r, x, y)) label_tree(m, r, &s, i, &tail);
+            }
+        }
+
+        // 2) Keep the passages from every opening up to its root, stopping
+        //    where an earlier opening's path already joined
+        for (size_t y = r->y0; y < r->y1; ++y) {
+            for (size_t x = r->x0; x < r->x1; x = next_border_x(r, x, y)) {
+                if (!is_opening(m, r, x, y)) continue;
+                for (uint32_t i = (uint32_t)((y - r->y0) * s.width + (x - r->x0)); !s.keep[i]; i = s.parent[i]) {
+                    s.keep[i] = 1;
+                }
+            }
+        }
+
+        // 3) Every wall between region cells back up and no cell visited;
+        //    the border is left alone
+        for (size_t y = r->y0; y < r->y1; ++y) {
+            fill_bits(m->visited + y * m->row_words, r->x0, r->x1, false);
+            fill_bits(m->walls + y * 2 * m->row_words, r->x0, r->x1 - 1, true);
+            if (y + 1 < r->y1) fill_bits(m->walls + y * 2 * m->row_words + m->row_words, r->x0, r->x1, true);
+        }
+
+        // 4) Reopen the kept passages
+        for (size_t k = 0; k < tail; ++k) {
+            uint32_t i = s.queue[k];
+            if (!s.keep[i]) continue;
+            size_t x = r->x0 + i % s.width, y = r->y0 + i / s.width;
+            size_t px = r->x0 + s.parent[i] % s.width, py = r->y0 + s.parent[i] / s.width;
+            *maze_visited_word(m, x, y) |= maze_bit_mask(x);
+            if (py < y) *maze_south_word(m, x, py) &= ~maze_bit_mask(x);
+            else if (py > y) *maze_south_word(m, x, y) &= ~maze_bit_mask(x);
+            else if (px < x) *maze_east_word(m, px, y) &= ~maze_bit_mask(px);
+            else if (px > x) *maze_east_word(m, x, y) &= ~maze_bit_mask(x);
+        }
+
+        // 5) Carve the rest from the kept cells; with no openings at all the
+        //    region is the whole maze and grows from the start cell
+        bool seeded = false;
+        for (size_t k = 0; ok && k < tail; ++k) {
+            uint32_t i = s.queue[k];
+            if (!s.keep[i]) continue;
+            seeded = true;
+            ok = maze_generate_dfs_region(m, rng, m->stack, r, maze_cell_index(m, r->x0 + i % s.width, r->y0 + i / s.width));
+        }
+        if (ok && !seeded) {
+            bool start_inside = (size_t)m->start.x >= r->x0 && (size_t)m->start.x < r->x1 &&
+                                (size_t)m->start.y >= r->y0 && (size_t)m->start.y < r->y1;
+            size_t x = start_inside ? (size_t)m->start.x : r->x0 + rng_bounded(rng, (uint32_t)(r->x1 - r->x0));
+            size_t y = start_inside ? (size_t)m->start.y : r->y0 + rng_bounded(rng, (uint32_t)(r->y1 - r->y0));
+            ok = maze_generate_dfs_region(m, rng, m->stack, r, maze_cell_index(m, x, y));
+        }
+    }
+
+    free(s.parent);
+    free(s.queue);
+    free(s.keep);
+    return ok;
+}
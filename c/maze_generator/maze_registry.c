@@ -0,0 +1,79 @@
+#include "maze_generator.h"
+
+#include <string.h> // for strcmp
+
+typedef struct MazeGenContext MazeGenContext;
+typedef struct MazeGenerator MazeGenerator;
+
+static bool generate_eller(MazeGenContext *ctx) {
+    return maze_generate_eller(ctx->m->width, ctx->m->height, ctx->rng, maze_store_row, ctx->m);
+}
+
+static bool generate_dfs(MazeGenContext *ctx) { return maze_generate_dfs(ctx->m, ctx->rng); }
+static bool generate_tiled(MazeGenContext *ctx) { return maze_generate_tiled(ctx->m, ctx->rng, ctx->pool); }
+static bool generate_kruskal(MazeGenContext *ctx) { return maze_generate_kruskal(ctx->m, ctx->rng, ctx->pool); }
+static bool generate_kruskal_parallel(MazeGenContext *ctx) { return maze_generate_kruskal_parallel(ctx->m, ctx->rng, ctx->pool); }
+static bool generate_dfs_blocked(MazeGenContext *ctx) { return maze_generate_dfs_blocked(ctx->m, ctx->rng); }
+static bool generate_binary_tree(MazeGenContext *ctx) { return maze_generate_binary_tree(ctx->m, ctx->rng, ctx->pool); }
+static bool generate_sidewinder(MazeGenContext *ctx) { return maze_generate_sidewinder(ctx->m, ctx->rng, ctx->pool); }
+static bool grow_newest(MazeGenContext *ctx) { return maze_generate_growing_tree(ctx, MAZE_GROW_NEWEST); }
+static bool grow_random(MazeGenContext *ctx) { return maze_generate_growing_tree(ctx, MAZE_GROW_RANDOM); }
+static bool grow_oldest(MazeGenContext *ctx) { return maze_generate_growing_tree(ctx, MAZE_GROW_OLDEST); }
+static bool grow_mixed(MazeGenContext *ctx) { return maze_generate_growing_tree(ctx, MAZE_GROW_MIXED); }
+
+// Indexed by algorithm id
+static const MazeGenerator GENERATORS[] = {
+    { MAZE_ALGO_DFS, "dfs", "maze_generate_dfs()", NULL, generate_dfs, NULL },
+    { MAZE_ALGO_ELLER, "eller", "maze_generate_eller()", NULL, generate_eller, NULL },
+    { MAZE_ALGO_TILED, "tiled", "maze_generate_tiled()", NULL, generate_tiled, NULL },
+    { MAZE_ALGO_KRUSKAL, "kruskal", "maze_generate_kruskal()", NULL, generate_kruskal, NULL },
+    { MAZE_ALGO_KRUSKAL_PARALLEL, "kruskal-mt", "maze_generate_kruskal_parallel()", NULL, generate_kruskal_parallel, NULL },
+    { MAZE_ALGO_DFS_BLOCKED, "dfs-blocked", "maze_generate_dfs_blocked()", NULL, generate_dfs_blocked, NULL },
+    { MAZE_ALGO_BINARY_TREE, "binary-tree", "maze_generate_binary_tree()", NULL, generate_binary_tree, NULL },
+    { MAZE_ALGO_SIDEWINDER, "sidewinder", "maze_generate_sidewinder()", NULL, generate_sidewinder, NULL },
+    { MAZE_ALGO_GROWING_NEWEST, "growing-newest", "maze_generate_growing_tree()", maze_growing_tree_init, grow_newest, maze_growing_tree_free },
+    { MAZE_ALGO_GROWING_RANDOM, "growing-random", "maze_generate_growing_tree()", maze_growing_tree_init, grow_random, maze_growing_tree_free },
+    { MAZE_ALGO_GROWING_OLDEST, "growing-oldest", "maze_generate_growing_tree()", maze_growing_tree_init, grow_oldest, maze_growing_tree_free },
+    { MAZE_ALGO_GROWING_MIXED, "growing-mixed", "maze_generate_growing_tree()", maze_growing_tree_init, grow_mixed, maze_growing_tree_free },
+};
+
+#define GENERATOR_COUNT (sizeof(GENERATORS) / sizeof(GENERATORS[0]))
+
+_Static_assert(GENERATOR_COUNT == MAZE_ALGO_GROWING_MIXED + 1, "every algorithm needs a generator");
+
+const struct MazeGenerator *maze_generators(size_t *out_count) {
+    if (out_count) *out_count = GENERATOR_COUNT;
+    return GENERATORS;
+}
+
+const struct MazeGenerator *maze_generator_find(enum MazeAlgorithm algo) {
+    return (size_t)algo < GENERATOR_COUNT ? &GENERATORS[algo] : NULL;
+}
+
+bool maze_generator_run(const struct MazeGenerator *g, struct MazeGenContext *ctx) {
+    if (!g || !ctx || !ctx->m || !ctx->rng) return false;
+
+    ctx->state = NULL;
+    if (g->init && !g->init(ctx)) return false;
+    bool ok = g->generate(ctx);
+    if (g->free) g->free(ctx);
+    ctx->state = NULL;
+    return ok;
+}
+
+const char *maze_algorithm_name(enum MazeAlgorithm algo) {
+    const MazeGenerator *g = maze_generator_find(algo);
+    return g ? g->name : "unknown";
+}
+
+bool maze_algorithm_from_name(const char *name, enum MazeAlgorithm *out_algo) {
+    if (!name || !out_algo) return false;
+
+    for (size_t i = 0; i < GENERATOR_COUNT; ++i) {
+        if (strcmp(name, GENERATORS[i].name) == 0) {
+            *out_algo = GENERATORS[i].algorithm;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,119 @@
+#include "maze_generator.h"
+
+#include <string.h> // for memset
+
+typedef struct Maze Maze;
+typedef struct Rng Rng;
+typedef struct ThreadPool ThreadPool;
+
+// Binary tree and sidewinder
+// --------------------------
+// Both decide every row on its own. Binary tree opens the east or the south
+// wall of each cell on a coin flip; sidewinder cuts a row into runs of cells
+// joined east-west and opens the south wall of one cell per run. A row's wall
+// words are therefore built 64 cells at a time from one 64-bit draw each,
+// straight into the grid. Both carve toward the last row, which is a single
+// corridor, so a row writes only its own words and rows can go to any thread.
+// Each row draws from its own stream: the maze depends on the seed alone,
+// not on the thread count.
+//
+// They are the fastest generators here and the plainest to look at: binary
+// tree has corridors along the last row and column and every path drifts
+// toward the bottom-right corner; sidewinder has the one corridor along the
+// last row.
+
+#define BAND_CELLS 65536 // Cells per task, about; bands are whole rows
+
+typedef void (*RowGenerator)(Maze *m, Rng *rng, size_t y);
+
+struct RowJob {
+    Maze *m;
+    uint64_t seed; // Base seed of the per-row streams
+    size_t band; // Rows per task
+    RowGenerator row;
+};
+
+static inline uint64_t word_mask(const Maze *m, size_t w) {
+    return w + 1 == m->row_words && (m->width & 63) ? maze_bit_mask(m->width) - 1 : ~(uint64_t)0; // Valid bits of word w
+}
+
+// A set draw bit opens the cell's east wall, a clear one its south wall. The
+// last column can only open south, and the last row only east.
+static void binary_tree_row(Maze *m, Rng *rng, size_t y) {
+    size_t rw = m->row_words, last = m->width - 1;
+    uint64_t *east = m->walls + y * 2 * rw, *south = east + rw;
+    bool bottom = y + 1 == m->height;
+
+    for (size_t w = 0; w < rw; ++w) {
+        uint64_t open_east = bottom ? ~(uint64_t)0 : rng_next(rng);
+        east[w] = ~open_east & word_mask(m, w);
+        south[w] = open_east & word_mask(m, w);
+    }
+    east[last >> 6] |= maze_bit_mask(last);
+    if (!bottom) south[last >> 6] &= ~maze_bit_mask(last);
+}
+
+// A clear draw bit ends the run at that cell (an east wall); the last column
+// always does. Then each run opens the south wall of one of its cells, picked
+// by a multiply-shift of 32 random bits: off uniform by under 2^-25 for a run
+// of 64 cells, and with no branch on the run length, which is a coin flip.
+static void sidewinder_row(Maze *m, Rng *rng, size_t y) {
+    size_t rw = m->row_words, last = m->width - 1;
+    uint64_t *east = m->walls + y * 2 * rw, *south = east + rw;
+    bool bottom = y + 1 == m->height;
+
+    for (size_t w = 0; w < rw; ++w) {
+        east[w] = bottom ? 0 : ~rng_next(rng) & word_mask(m, w);
+        south[w] = word_mask(m, w);
+    }
+    east[last >> 6] |= maze_bit_mask(last);
+    if (bottom) return;
+
+    size_t run = 0; // First cell of the current run
+    for (size_t w = 0; w < rw; ++w) {
+        for (uint64_t ends = east[w]; ends; ends &= ends - 1) {
+            size_t x = w * 64 + __builtin_ctzll(ends);
+            size_t pick = run + (size_t)(((rng_next(rng) >> 32) * (x - run + 1)) >> 32);
+            south[pick >> 6] &= ~maze_bit_mask(pick);
+            run = x + 1;
+        }
+    }
+}
+
+static void generate_band(void *ctx, size_t task, unsigned worker) {
+    (void)worker;
+    const struct RowJob *job = ctx;
+    Maze *m = job->m;
+    size_t y0 = task * job->band, y1 = y0 + job->band < m->height ? y0 + job->band : m->height;
+
+    for (size_t y = y0; y < y1; ++y) {
+        Rng rng;
+        rng_seed_stream(&rng, job->seed, y);
+        job->row(m, &rng, y);
+    }
+    memset(m->visited + y0 * m->row_words, 0, (y1 - y0) * m->row_words * sizeof(uint64_t));
+}
+
+static bool generate_rows(Maze *m, Rng *rng, ThreadPool *pool, RowGenerator row) {
+    if (!m || !m->walls || !rng) return false;
+
+    // Every wall word is written, so no reset is needed
+    struct RowJob job = { m, rng_next(rng), BAND_CELLS / m->width, row };
+    if (job.band == 0) job.band = 1;
+    threadpool_run(pool, (m->height + job.band - 1) / job.band, generate_band, &job);
+
+    // Left as maze_reset leaves it: only the start cell visited
+    if (m->start.x >= 0 && m->start.x < (int64_t)m->width &&
+        m->start.y >= 0 && m->start.y < (int64_t)m->height) {
+        *maze_visited_word(m, m->start.x, m->start.y) |= maze_bit_mask(m->start.x);
+    }
+    return true;
+}
+
+bool maze_generate_binary_tree(struct Maze *m, struct Rng *rng, struct ThreadPool *pool) {
+    return generate_rows(m, rng, pool, binary_tree_row);
+}
+
+bool maze_generate_sidewinder(struct Maze *m, struct Rng *rng, struct ThreadPool *pool) {
+    return generate_rows(m, rng, pool, sidewinder_row);
+}
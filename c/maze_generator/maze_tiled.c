@@ -0,0 +1,112 @@
+#include "maze_generator.h"
+
+#include <stdatomic.h> // for atomic_bool
+#include <stdlib.h> // for calloc, free
+
+typedef struct Maze Maze;
+typedef struct MazeRegion MazeRegion;
+typedef struct Point Point;
+typedef struct Rng Rng;
+typedef struct Stack Stack;
+typedef struct ThreadPool ThreadPool;
+
+// Shared, read-only description of the tile pass; each task owns one tile
+struct TileJob {
+    Maze *m;
+    uint64_t seed; // Base seed of the per-tile random streams
+    size_t tiles_x; // Tiles per row
+    Stack **stacks; // One DFS stack per worker
+    atomic_bool failed;
+};
+
+static void tile_region(const Maze *m, size_t tx, size_t ty, MazeRegion *r) {
+    r->x0 = tx * MAZE_TILE_WIDTH;
+    r->y0 = ty * MAZE_TILE_HEIGHT;
+    r->x1 = r->x0 + MAZE_TILE_WIDTH < m->width ? r->x0 + MAZE_TILE_WIDTH : m->width;
+    r->y1 = r->y0 + MAZE_TILE_HEIGHT < m->height ? r->y0 + MAZE_TILE_HEIGHT : m->height;
+}
+
+// Build a perfect maze inside one tile. Tiles start on 512-column
+// boundaries, so no two tasks write to the same word of any bit plane.
+static void generate_tile(void *ctx, size_t task, unsigned worker) {
+    struct TileJob *job = ctx;
+    Maze *m = job->m;
+    MazeRegion r;
+    tile_region(m, task % job->tiles_x, task / job->tiles_x, &r);
+
+    // The stream depends on the tile only, not on which worker runs it
+    Rng rng;
+    rng_seed_stream(&rng, job->seed, task);
+
+    size_t start;
+    if ((size_t)m->start.x >= r.x0 && (size_t)m->start.x < r.x1 &&
+        (size_t)m->start.y >= r.y0 && (size_t)m->start.y < r.y1) {
+        start = maze_cell_index(m, m->start.x, m->start.y);
+    } else {
+        size_t x = r.x0 + rng_bounded(&rng, (uint32_t)(r.x1 - r.x0));
+        size_t y = r.y0 + rng_bounded(&rng, (uint32_t)(r.y1 - r.y0));
+        start = maze_cell_index(m, x, y);
+    }
+
+    if (!maze_generate_dfs_region(m, &rng, job->stacks[worker], &r, start)) {
+        atomic_store(&job->failed, true);
+    }
+}
+
+bool maze_generate_tiled(Maze *m, Rng *rng, ThreadPool *pool) {
+    if (!m || !m->walls || !rng) return false;
+
+    maze_reset(m);
+
+    size_t tiles_x = (m->width + MAZE_TILE_WIDTH - 1) / MAZE_TILE_WIDTH;
+    size_t tiles_y = (m->height + MAZE_TILE_HEIGHT - 1) / MAZE_TILE_HEIGHT;
+    unsigned workers = threadpool_size(pool);
+
+    struct TileJob job;
+    job.m = m;
+    job.seed = rng_next(rng);
+    job.tiles_x = tiles_x;
+    job.stacks = calloc(workers, sizeof(Stack *));
+    atomic_init(&job.failed, job.stacks == NULL);
+    for (unsigned w = 0; job.stacks && w < workers; ++w) {
+        job.stacks[w] = createStack(-1);
+        if (!job.stacks[w]) atomic_store(&job.failed, true);
+    }
+
+    // 1) A perfect maze inside every tile, in parallel
+    if (!atomic_load(&job.failed)) {
+        threadpool_run(pool, tiles_x * tiles_y, generate_tile, &job);
+    }
+
+    for (unsigned w = 0; job.stacks && w < workers; ++w) {
+        freeStack(job.stacks[w]);
+    }
+    free(job.stacks);
+    if (atomic_load(&job.failed)) return false;
+
+    // 2) A random spanning tree over the tiles: a maze of tiles
+    Point tile_start = { m->start.x / MAZE_TILE_WIDTH, m->start.y / MAZE_TILE_HEIGHT };
+    Maze *tiles = maze_create(tiles_x, tiles_y, 1, tile_start, tile_start, 1);
+    if (!tiles) return false;
+    if (!maze_generate_dfs(tiles, rng)) {
+        maze_free(tiles);
+        return false;
+    }
+
+    // 3) One random passage across the seam of every edge of that tree
+    for (size_t t = 0; t < tiles_x * tiles_y; ++t) {
+        MazeRegion r;
+        tile_region(m, t % tiles_x, t / tiles_x, &r);
+        if (!maze_has_wall(tiles, t, RIGHT)) {
+            size_t y = r.y0 + rng_bounded(rng, (uint32_t)(r.y1 - r.y0));
+            maze_remove_wall(m, maze_cell_index(m, r.x1 - 1, y), RIGHT);
+        }
+        if (!maze_has_wall(tiles, t, DOWN)) {
+            size_t x = r.x0 + rng_bounded(rng, (uint32_t)(r.x1 - r.x0));
+            maze_remove_wall(m, maze_cell_index(m, x, r.y1 - 1), DOWN);
+        }
+    }
+
+    maze_free(tiles);
+    return true;
+}
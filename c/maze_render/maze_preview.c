@@ -0,0 +1,208 @@
+#include "maze_render.h"
+
+#include <stdlib.h> // for malloc, calloc, free
+#include <string.h> // for memcpy, memset
+
+typedef struct BmpImage BmpImage;
+typedef struct Point Point;
+typedef struct Maze Maze;
+typedef struct MazeRow MazeRow;
+typedef struct MazeRenderConfig MazeRenderConfig;
+typedef struct MazePreview MazePreview;
+typedef struct ThreadPool ThreadPool;
+
+#define MAX_PREVIEW_SIZE 65536 // Pixels a side
+
+// A preview pixel stands for a block of whole cells: pixel column px covers
+// cell columns [px * width / pw, (px + 1) * width / pw), and rows likewise.
+// Its color is the exact average of the full-size render over the block,
+// worked out from how many pixels of each color the block's cells would have.
+// Cells never become pixels: the wall pixels of a cell follow from its four
+// wall bits, so a cell row is summed 64 cells at a time with popcounts.
+struct MazePreview {
+    MazeRenderConfig cfg;
+    Point start, end;
+    size_t width, height; // in cells
+    size_t pw, ph; // in pixels
+    BmpImage *img;
+    uint64_t *sums; // Wall pixels of each block of the pixel row being summed
+    uint64_t *north; // South walls of the previous cell row
+    size_t next_y; // Cell row expected next
+    size_t py; // Pixel row being summed
+    bool ok;
+};
+
+static inline size_t block_start(size_t p, size_t cells, size_t pixels) {
+    return (size_t)((uint64_t)p * cells / pixels);
+}
+
+// Add the wall pixels of a cell row to the blocks of sums. A cell has
+// T * cs pixels of wall per wall, less the T x T corners where an across wall
+// (up, down) meets a side one (left, right).
+static void sum_row(const MazePreview *p, const MazeRow *mr, const uint64_t *north, uint64_t *sums) {
+    uint64_t cs = p->cfg.cell_size, T = p->cfg.wall_thickness;
+    size_t px = 0, next = block_start(1, p->width, p->pw);
+
+    for (size_t w = 0; w < mr->row_words; ++w) {
+        uint64_t up = north ? north[w] : ~(uint64_t)0;
+        uint64_t down = mr->south[w];
+        uint64_t right = mr->east[w];
+        uint64_t left = right << 1 | (w > 0 ? mr->east[w - 1] >> 63 : 1);
+
+        // Split the word where blocks end
+        size_t x = w * 64, end = x + 64 < p->width ? x + 64 : p->width;
+        while (x < end) {
+            while (x >= next) next = block_start(++px + 1, p->width, p->pw);
+            size_t stop = next < end ? next : end;
+            uint64_t mask = (stop - w * 64 == 64 ? ~(uint64_t)0 : maze_bit_mask(stop - w * 64) - 1)
+                          & ~(maze_bit_mask(x - w * 64) - 1);
+            uint64_t walls = __builtin_popcountll(up & mask) + __builtin_popcountll(down & mask) +
+                             __builtin_popcountll(left & mask) + __builtin_popcountll(right & mask);
+            uint64_t corners = __builtin_popcountll(up & left & mask) + __builtin_popcountll(up & right & mask) +
+                               __builtin_popcountll(down & left & mask) + __builtin_popcountll(down & right & mask);
+            sums[px] += T * cs * walls - T * T * corners;
+            x = stop;
+        }
+    }
+}
+
+static inline bool in_block(Point cell, size_t x0, size_t x1, size_t y0, size_t y1) {
+    return cell.x >= (int64_t)x0 && cell.x < (int64_t)x1 && cell.y >= (int64_t)y0 && cell.y < (int64_t)y1;
+}
+
+static inline uint8_t blend(uint64_t wall, uint8_t wc, uint64_t start, uint8_t sc, uint64_t end, uint8_t ec,
+                            uint64_t bg, uint8_t bc, uint64_t total) {
+    return (uint8_t)((wall * wc + start * sc + end * ec + bg * bc + total / 2) / total);
+}
+
+// Color pixel row py from the summed wall pixels of its blocks
+static void emit_row(const MazePreview *p, size_t py, const uint64_t *sums) {
+    const MazeRenderConfig *cfg = &p->cfg;
+    uint64_t cs = cfg->cell_size, T = cfg->wall_thickness;
+    uint64_t marker = cfg->markers ? (cs - 2 * T) * (cs - 2 * T) : 0; // Marker insets are never wall
+    size_t y0 = block_start(py, p->height, p->ph), y1 = block_start(py + 1, p->height, p->ph);
+    struct RGBTriple *row = bmp_row(p->img, (int)py);
+
+    for (size_t px = 0; px < p->pw; ++px) {
+        size_t x0 = block_start(px, p->width, p->pw), x1 = block_start(px + 1, p->width, p->pw);
+        uint64_t total = (uint64_t)(x1 - x0) * (y1 - y0) * cs * cs;
+        bool covered = p->start.x == p->end.x && p->start.y == p->end.y; // The end marker is painted last
+        uint64_t start = in_block(p->start, x0, x1, y0, y1) && !covered ? marker : 0;
+        uint64_t end = in_block(p->end, x0, x1, y0, y1) ? marker : 0;
+        uint64_t bg = total - sums[px] - start - end;
+        row[px].rgbtBlue = blend(sums[px], cfg->wall_color.rgbtBlue, start, cfg->start_color.rgbtBlue,
+                                 end, cfg->end_color.rgbtBlue, bg, cfg->bg_color.rgbtBlue, total);
+        row[px].rgbtGreen = blend(sums[px], cfg->wall_color.rgbtGreen, start, cfg->start_color.rgbtGreen,
+                                  end, cfg->end_color.rgbtGreen, bg, cfg->bg_color.rgbtGreen, total);
+        row[px].rgbtRed = blend(sums[px], cfg->wall_color.rgbtRed, start, cfg->start_color.rgbtRed,
+                                end, cfg->end_color.rgbtRed, bg, cfg->bg_color.rgbtRed, total);
+    }
+}
+
+MazePreview *maze_preview_open(size_t width, size_t height, const MazeRenderConfig *cfg, Point start, Point end, size_t preview_width) {
+    if (!cfg || width == 0 || height == 0 || preview_width == 0 || preview_width > MAX_PREVIEW_SIZE) return NULL;
+
+    MazePreview *p = calloc(1, sizeof(MazePreview));
+    if (!p) return NULL;
+
+    // At most one pixel per cell; the height keeps the maze's aspect ratio
+    // unless that is over MAX_PREVIEW_SIZE
+    p->cfg = *cfg;
+    p->start = start;
+    p->end = end;
+    p->width = width;
+    p->height = height;
+    p->pw = preview_width < width ? preview_width : width;
+    p->ph = (size_t)(((uint64_t)height * p->pw + width / 2) / width);
+    if (p->ph == 0) p->ph = 1;
+    if (p->ph > height) p->ph = height;
+    if (p->ph > MAX_PREVIEW_SIZE) p->ph = MAX_PREVIEW_SIZE;
+    p->img = bmp_create((int)p->pw, (int)p->ph);
+    p->sums = calloc(p->pw, sizeof(uint64_t));
+    p->north = malloc((width + 63) / 64 * sizeof(uint64_t));
+    p->ok = p->img && p->sums && p->north;
+    if (!p->ok) {
+        bmp_free(maze_preview_close(p));
+        return NULL;
+    }
+    return p;
+}
+
+bool maze_preview_row(const MazeRow *row, void *preview) {
+    MazePreview *p = preview;
+    if (!p->ok || row->y != p->next_y || row->width != p->width) {
+        p->ok = false;
+        return false;
+    }
+    ++p->next_y;
+
+    sum_row(p, row, row->y > 0 ? p->north : NULL, p->sums);
+    memcpy(p->north, row->south, row->row_words * sizeof(uint64_t));
+
+    // The last cell row of a block row finishes a pixel row
+    if (row->y + 1 == block_start(p->py + 1, p->height, p->ph)) {
+        emit_row(p, p->py++, p->sums);
+        memset(p->sums, 0, p->pw * sizeof(uint64_t));
+    }
+    return true;
+}
+
+BmpImage *maze_preview_close(MazePreview *p) {
+    if (!p) return NULL;
+
+    BmpImage *img = p->img;
+    if (!p->ok || p->py != p->ph) {
+        bmp_free(img);
+        img = NULL;
+    }
+    free(p->sums);
+    free(p->north);
+    free(p);
+    return img;
+}
+
+// One parallel preview; task py sums the block row of pixel row py
+struct PreviewJob {
+    MazePreview *p;
+    const Maze *m;
+    uint64_t *sums; // pw sums per worker
+};
+
+// Pixel rows cover disjoint cell rows and image rows
+static void preview_band(void *ctx, size_t py, unsigned worker) {
+    const struct PreviewJob *job = ctx;
+    const MazePreview *p = job->p;
+    uint64_t *sums = job->sums + worker * p->pw;
+    memset(sums, 0, p->pw * sizeof(uint64_t));
+
+    MazeRow row;
+    for (size_t y = block_start(py, p->height, p->ph); y < block_start(py + 1, p->height, p->ph); ++y) {
+        maze_get_row(job->m, y, &row);
+        sum_row(p, &row, y > 0 ? maze_row_south(job->m, y - 1) : NULL, sums);
+    }
+    emit_row(p, py, sums);
+}
+
+BmpImage *maze_render_preview(const Maze *m, const MazeRenderConfig *cfg, size_t preview_width, ThreadPool *pool) {
+    if (!m) return NULL;
+
+    MazeRenderConfig defaults;
+    if (!cfg) {
+        maze_render_config_init(&defaults, m);
+        cfg = &defaults;
+    }
+
+    MazePreview *p = maze_preview_open(m->width, m->height, cfg, m->start, m->end, preview_width);
+    if (!p) return NULL;
+
+    struct PreviewJob job = { p, m, malloc(threadpool_size(pool) * p->pw * sizeof(uint64_t)) };
+    if (job.sums) {
+        threadpool_run(pool, p->ph, preview_band, &job);
+        p->py = p->ph;
+        p->next_y = m->height;
+    } else {
+        p->ok = false;
+    }
+    free(job.sums);
+    return maze_preview_close(p);
+}
@@ -0,0 +1,935 @@
+#include "maze_render.h"
+#include "../maze_stats/maze_stats.h"
+
+#include <stdlib.h> // for abs, malloc, calloc, free
+#include <string.h> // for memcpy, memset
+
+typedef struct RGBTriple RGBTriple;
+typedef struct BmpImage BmpImage;
+typedef struct BmpWriter BmpWriter;
+typedef struct BmpFormat BmpFormat;
+typedef struct Point Point;
+typedef struct Maze Maze;
+typedef struct MazeRegion MazeRegion;
+typedef struct MazeRow MazeRow;
+typedef struct MazeRenderConfig MazeRenderConfig;
+typedef struct MazeSolution MazeSolution;
+typedef struct MazeDistances MazeDistances;
+typedef struct ThreadPool ThreadPool;
+
+RGBTriple MAZE_START_COLOR = {0, 255, 0}; // default start color
+RGBTriple MAZE_END_COLOR = {255, 0, 0};   // default end color
+RGBTriple MAZE_WALL_COLOR = {0, 0, 0};    // default wall color
+RGBTriple MAZE_BG_COLOR = {255, 255, 255}; // default background color
+RGBTriple MAZE_PATH_COLOR = {0, 0, 255};   // default path color
+
+#define RUN_PIXELS 64 // Pixels in a prebuilt run of one color
+#define MAX_PIXEL_BYTES 3 // An RGB triple; palette indices take one byte
+
+// A pixel value with a prebuilt run of it, so a span fills with a few memcpys
+struct Fill {
+    uint8_t pixel[MAX_PIXEL_BYTES]; // Blue, green, red, or a palette index
+    size_t bytes; // Bytes per pixel
+    bool uniform; // All bytes of the pixel are equal: a span is a single memset
+    enum MazeStatsColor stat; // What its pixels are counted as
+    uint8_t run[RUN_PIXELS * MAX_PIXEL_BYTES];
+};
+
+#define HEAT_LEVELS (256 - MAZE_INDEX_HEAT) // Steps of the heatmap gradient, as many as an 8-bit palette has room for
+
+#define ATLAS_TILES 16 // One tile per combination of the four walls
+#define ATLAS_ALIGN 64 // Alignment of the atlas and of each of its rows
+
+// Wall-mask bits of a tile, one per Direction
+#define MASK_UP (1u << UP)
+#define MASK_RIGHT (1u << RIGHT)
+#define MASK_DOWN (1u << DOWN)
+#define MASK_LEFT (1u << LEFT)
+
+enum RowClass {
+    ROW_TOP,    // Pixel rows [0, T): north wall stripe
+    ROW_MIDDLE, // Pixel rows [T, cs - T): cell interiors
+    ROW_BOTTOM  // Pixel rows [cs - T, cs): south wall stripe
+};
+
+struct RowStyle;
+
+// Copies one tile row per cell into a scanline; n cells, starting at column 0
+typedef void (*ComposeKernel)(uint8_t *dst, const struct RowStyle *st, const MazeRow *mr, const uint64_t *north, enum RowClass cls, size_t n);
+
+// Everything the scanline builder needs for one render call. The atlas holds
+// the 16 pre-rendered cell tiles. A tile has only three distinct pixel rows
+// (one per RowClass), so those are what the atlas stores.
+//
+// 24-bit output is built from RGB triples and 8-bit output from palette
+// indices. 1-bit output is built as 8-bit indices in a scratch row, then
+// packed eight pixels to a byte.
+struct RowStyle {
+    size_t cell_size;
+    size_t wall_thickness;
+    size_t limit; // Pixel width of the destination rows
+    size_t pixel_bytes; // Bytes per pixel while building a scanline
+    bool packed; // 1-bit output
+    size_t row_bytes; // Bytes of one destination row
+    struct Fill bg;
+    struct Fill wall;
+    struct Fill start;
+    struct Fill end;
+    struct Fill path;
+    const MazeDistances *heat; // Heatmap distances, NULL when not drawn
+    uint8_t heat_pixels[HEAT_LEVELS * MAX_PIXEL_BYTES]; // Pixel of each gradient step
+    uint8_t *atlas; // Aligned tile rows, see atlas_row
+    size_t atlas_stride; // Bytes per atlas row
+    void *atlas_block; // Allocation backing the atlas
+    ComposeKernel compose;
+};
+
+static inline bool row_bit(const uint64_t *bits, size_t x) {
+    return (bits[x >> 6] >> (x & 63)) & 1;
+}
+
+// Wall mask of cell x: its index into the atlas
+static inline unsigned cell_mask(const MazeRow *mr, const uint64_t *north, size_t x) {
+    return (!north || row_bit(north, x) ? MASK_UP : 0)
+         | (row_bit(mr->east, x) ? MASK_RIGHT : 0)
+         | (row_bit(mr->south, x) ? MASK_DOWN : 0)
+         | (x == 0 || row_bit(mr->east, x - 1) ? MASK_LEFT : 0);
+}
+
+static inline const uint8_t *atlas_row(const struct RowStyle *st, unsigned mask, enum RowClass cls) {
+    return st->atlas + (mask * 3 + cls) * st->atlas_stride;
+}
+
+static inline void compose_cells(uint8_t *dst, const struct RowStyle *st, const MazeRow *mr, const uint64_t *north, enum RowClass cls, size_t n, size_t bytes) {
+    for (size_t x = 0; x < n; ++x, dst += bytes) {
+        memcpy(dst, atlas_row(st, cell_mask(mr, north, x), cls), bytes);
+    }
+}
+
+static void compose_generic(uint8_t *dst, const struct RowStyle *st, const MazeRow *mr, const uint64_t *north, enum RowClass cls, size_t n) {
+    compose_cells(dst, st, mr, north, cls, n, st->cell_size * st->pixel_bytes);
+}
+
+// Small cells get kernels whose memcpy size is a compile-time constant, so
+// each tile row becomes a couple of plain loads and stores
+#define COMPOSE_KERNEL(CS)                                                                                    \
+    static void compose_##CS##_rgb(uint8_t *dst, const struct RowStyle *st, const MazeRow *mr,                \
+                                   const uint64_t *north, enum RowClass cls, size_t n) {                      \
+        compose_cells(dst, st, mr, north, cls, n, (CS) * sizeof(RGBTriple));                                  \
+    }                                                                                                         \
+    static void compose_##CS##_index(uint8_t *dst, const struct RowStyle *st, const MazeRow *mr,              \
+                                     const uint64_t *north, enum RowClass cls, size_t n) {                    \
+        compose_cells(dst, st, mr, north, cls, n, (CS));                                                      \
+    }
+
+COMPOSE_KERNEL(4)
+COMPOSE_KERNEL(5)
+COMPOSE_KERNEL(6)
+COMPOSE_KERNEL(7)
+COMPOSE_KERNEL(8)
+COMPOSE_KERNEL(9)
+COMPOSE_KERNEL(10)
+COMPOSE_KERNEL(11)
+COMPOSE_KERNEL(12)
+COMPOSE_KERNEL(13)
+COMPOSE_KERNEL(14)
+COMPOSE_KERNEL(15)
+COMPOSE_KERNEL(16)
+
+#define SMALL_KERNEL_SIZES 17 // Kernels exist for cell sizes 4 .. 16
+
+static const ComposeKernel SMALL_KERNELS_RGB[SMALL_KERNEL_SIZES] = {
+    NULL, NULL, NULL, NULL,
+    compose_4_rgb, compose_5_rgb, compose_6_rgb, compose_7_rgb, compose_8_rgb, compose_9_rgb, compose_10_rgb,
+    compose_11_rgb, compose_12_rgb, compose_13_rgb, compose_14_rgb, compose_15_rgb, compose_16_rgb
+};
+
+static const ComposeKernel SMALL_KERNELS_INDEX[SMALL_KERNEL_SIZES] = {
+    NULL, NULL, NULL, NULL,
+    compose_4_index, compose_5_index, compose_6_index, compose_7_index, compose_8_index, compose_9_index, compose_10_index,
+    compose_11_index, compose_12_index, compose_13_index, compose_14_index, compose_15_index, compose_16_index
+};
+
+// Gradient from blue (near start) through cyan, green and yellow to red
+static RGBTriple heat_color(size_t level) {
+    unsigned t = (unsigned)(level * 1020 / (HEAT_LEVELS - 1));
+    unsigned f = t % 255;
+    RGBTriple c = { 0, 0, 0 };
+    switch (t / 255) {
+        case 0: c.rgbtBlue = 255; c.rgbtGreen = f; break;
+        case 1: c.rgbtGreen = 255; c.rgbtBlue = 255 - f; break;
+        case 2: c.rgbtGreen = 255; c.rgbtRed = f; break;
+        case 3: c.rgbtRed = 255; c.rgbtGreen = 255 - f; break;
+        default: c.rgbtRed = 255; break;
+    }
+    return c;
+}
+
+static void fill_init(struct Fill *f, const void *pixel, size_t bytes, enum MazeStatsColor stat) {
+    memcpy(f->pixel, pixel, bytes);
+    f->bytes = bytes;
+    f->stat = stat;
+    f->uniform = true;
+    for (size_t i = 1; i < bytes; ++i) {
+        if (f->pixel[i] != f->pixel[0]) f->uniform = false;
+    }
+    for (size_t i = 0; i < RUN_PIXELS; ++i) {
+        memcpy(f->run + i * bytes, pixel, bytes);
+    }
+}
+
+static inline void fill_span(uint8_t *dst, size_t n, const struct Fill *f) {
+    if (f->uniform) {
+        memset(dst, f->pixel[0], n * f->bytes);
+        return;
+    }
+    while (n > RUN_PIXELS) {
+        memcpy(dst, f->run, RUN_PIXELS * f->bytes);
+        dst += RUN_PIXELS * f->bytes;
+        n -= RUN_PIXELS;
+    }
+    memcpy(dst, f->run, n * f->bytes);
+}
+
+// Pack n palette indices (0 or 1) into bits, leftmost pixel in the high bit.
+// Eight pixels at a time: one multiply gathers the low bit of each of the
+// eight bytes of a word into its top byte.
+static void pack_bits(uint8_t *dst, const uint8_t *idx, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t v;
+        memcpy(&v, idx + i, sizeof(v));
+        *dst++ = (uint8_t)((v * 0x8040201008040201ULL) >> 56);
+    }
+    if (i < n) {
+        uint8_t byte = 0;
+        for (size_t k = 0; i + k < n; ++k) {
+            byte |= idx[i + k] << (7 - k);
+        }
+        *dst = byte;
+    }
+}
+
+// Pre-render the three rows of each of the 16 tiles for a bit_count-deep
+// destination (24, 8 or 1)
+static bool style_init(struct RowStyle *st, const MazeRenderConfig *cfg, size_t limit, int bit_count) {
+    size_t cs = cfg->cell_size, T = cfg->wall_thickness;
+    st->cell_size = cs;
+    st->wall_thickness = T;
+    st->limit = limit;
+    st->row_bytes = 0;
+    st->atlas_block = NULL;
+    st->packed = bit_count == 1;
+    if (bit_count == 24) {
+        st->pixel_bytes = sizeof(RGBTriple);
+        fill_init(&st->bg, &cfg->bg_color, sizeof(RGBTriple), MAZE_STATS_BG);
+        fill_init(&st->wall, &cfg->wall_color, sizeof(RGBTriple), MAZE_STATS_WALL);
+        fill_init(&st->start, &cfg->start_color, sizeof(RGBTriple), MAZE_STATS_MARKER);
+        fill_init(&st->end, &cfg->end_color, sizeof(RGBTriple), MAZE_STATS_MARKER);
+        fill_init(&st->path, &cfg->path_color, sizeof(RGBTriple), MAZE_STATS_PATH);
+    } else if (bit_count == 8 || bit_count == 1) {
+        uint8_t bg = MAZE_INDEX_BG, wall = MAZE_INDEX_WALL, start = MAZE_INDEX_START, end = MAZE_INDEX_END, path = MAZE_INDEX_PATH;
+        st->pixel_bytes = 1;
+        fill_init(&st->bg, &bg, 1, MAZE_STATS_BG);
+        fill_init(&st->wall, &wall, 1, MAZE_STATS_WALL);
+        fill_init(&st->start, &start, 1, MAZE_STATS_MARKER);
+        fill_init(&st->end, &end, 1, MAZE_STATS_MARKER);
+        fill_init(&st->path, &path, 1, MAZE_STATS_PATH);
+    } else {
+        return false;
+    }
+    st->row_bytes = st->packed ? (limit + 7) / 8 : limit * st->pixel_bytes;
+
+    // 1-bit output has no palette entries for the gradient
+    st->heat = st->packed ? NULL : cfg->heatmap;
+    for (size_t i = 0; st->heat && i < HEAT_LEVELS; ++i) {
+        RGBTriple c = heat_color(i);
+        uint8_t index = (uint8_t)(MAZE_INDEX_HEAT + i);
+        memcpy(st->heat_pixels + i * st->pixel_bytes, st->pixel_bytes == 1 ? (const void *)&index : (const void *)&c, st->pixel_bytes);
+    }
+
+    const ComposeKernel *small = st->pixel_bytes == 1 ? SMALL_KERNELS_INDEX : SMALL_KERNELS_RGB;
+    st->compose = cs < SMALL_KERNEL_SIZES && small[cs] ? small[cs] : compose_generic;
+
+    st->atlas_stride = (cs * st->pixel_bytes + ATLAS_ALIGN - 1) & ~(size_t)(ATLAS_ALIGN - 1);
+    st->atlas_block = malloc(ATLAS_TILES * 3 * st->atlas_stride + ATLAS_ALIGN);
+    if (!st->atlas_block) return false;
+    st->atlas = (uint8_t *)(((uintptr_t)st->atlas_block + ATLAS_ALIGN - 1) & ~(uintptr_t)(ATLAS_ALIGN - 1));
+
+    for (unsigned mask = 0; mask < ATLAS_TILES; ++mask) {
+        for (int cls = ROW_TOP; cls <= ROW_BOTTOM; ++cls) {
+            bool across = (cls == ROW_TOP && (mask & MASK_UP)) || (cls == ROW_BOTTOM && (mask & MASK_DOWN));
+            uint8_t *row = (uint8_t *)atlas_row(st, mask, (enum RowClass)cls);
+            for (size_t x = 0; x < cs; ++x) {
+                bool wall = across || (x < T && (mask & MASK_LEFT)) || (x >= cs - T && (mask & MASK_RIGHT));
+                memcpy(row + x * st->pixel_bytes, wall ? st->wall.pixel : st->bg.pixel, st->pixel_bytes);
+            }
+        }
+    }
+    return true;
+}
+
+static void style_free(struct RowStyle *st) {
+    free(st->atlas_block);
+}
+
+// Recolor the open pixels of each cell in a scanline by the cell's distance
+// from start. A tile row is open over a single span: none of it when a wall
+// runs across, else all but the side walls.
+static void paint_heat(uint8_t *row, const struct RowStyle *st, const MazeRow *mr, const uint64_t *north, enum RowClass cls) {
+    size_t cs = st->cell_size, T = st->wall_thickness, pb = st->pixel_bytes;
+    const uint32_t *dist = st->heat->dist + mr->y * mr->width;
+    uint32_t max = st->heat->max;
+    size_t n = (st->limit + cs - 1) / cs < mr->width ? (st->limit + cs - 1) / cs : mr->width;
+
+    for (size_t x = 0; x < n; ++x) {
+        if (dist[x] == MAZE_UNREACHABLE) continue;
+        unsigned mask = cell_mask(mr, north, x);
+        if ((cls == ROW_TOP && (mask & MASK_UP)) || (cls == ROW_BOTTOM && (mask & MASK_DOWN))) continue;
+        size_t lo = x * cs + (mask & MASK_LEFT ? T : 0);
+        size_t hi = x * cs + cs - (mask & MASK_RIGHT ? T : 0);
+        if (hi > st->limit) hi = st->limit;
+        const uint8_t *pixel = st->heat_pixels + (max ? (uint64_t)dist[x] * (HEAT_LEVELS - 1) / max : 0) * pb;
+        for (size_t px = lo; px < hi; ++px) {
+            memcpy(row + px * pb, pixel, pb);
+        }
+    }
+}
+
+// Build one scanline of the given class for a cell row into `row`
+static void build_scanline(uint8_t *row, const struct RowStyle *st, const MazeRow *mr, const uint64_t *north, enum RowClass cls) {
+    size_t cs = st->cell_size, pb = st->pixel_bytes;
+    size_t full = st->limit / cs < mr->width ? st->limit / cs : mr->width; // Cells that fit entirely
+    st->compose(row, st, mr, north, cls, full);
+
+    size_t x = full * cs;
+    if (full < mr->width && x < st->limit) {
+        // The last cell is cut by the right edge of the image
+        memcpy(row + x * pb, atlas_row(st, cell_mask(mr, north, full), cls), (st->limit - x) * pb);
+    } else if (x < st->limit) {
+        // Pixels past the right edge of the maze
+        fill_span(row + x * pb, st->limit - x, &st->bg);
+    }
+    if (st->heat) paint_heat(row, st, mr, north, cls);
+}
+
+#ifdef MAZE_STATS
+// Count the pixels of a scanline that is written `rows` times, by color. Wall
+// pixels come from popcounts of the wall bits, 64 cells at a time, so the
+// pixels themselves are never looked at.
+static void count_scanline(const struct RowStyle *st, const MazeRow *mr, const uint64_t *north, enum RowClass cls, size_t rows) {
+    size_t cs = st->cell_size, T = st->wall_thickness;
+    size_t full = st->limit / cs < mr->width ? st->limit / cs : mr->width;
+    uint64_t wall = 0;
+    for (size_t w = 0; w * 64 < full; ++w) {
+        uint64_t valid = full - w * 64 >= 64 ? ~(uint64_t)0 : maze_bit_mask(full) - 1;
+        uint64_t right = mr->east[w];
+        uint64_t left = right << 1 | (w > 0 ? mr->east[w - 1] >> 63 : 1);
+        uint64_t across = cls == ROW_MIDDLE ? 0 : cls == ROW_BOTTOM ? mr->south[w] : north ? north[w] : ~(uint64_t)0;
+        across &= valid;
+        wall += cs * __builtin_popcountll(across) +
+                T * (__builtin_popcountll(left & ~across & valid) + __builtin_popcountll(right & ~across & valid));
+    }
+
+    size_t x = full * cs;
+    if (full < mr->width && x < st->limit) {
+        // The cut cell, as in build_scanline
+        size_t px = st->limit - x;
+        unsigned mask = cell_mask(mr, north, full);
+        if ((cls == ROW_TOP && (mask & MASK_UP)) || (cls == ROW_BOTTOM && (mask & MASK_DOWN))) {
+            wall += px;
+        } else {
+            if (mask & MASK_LEFT) wall += px < T ? px : T;
+            if ((mask & MASK_RIGHT) && px > cs - T) wall += px - (cs - T);
+        }
+    }
+    MAZE_STAT_ADD(pixels[MAZE_STATS_WALL], wall * rows);
+    MAZE_STAT_ADD(pixels[MAZE_STATS_BG], (st->limit - wall) * rows);
+
+    // Heat is painted over the open pixels, the spans paint_heat fills
+    uint64_t heat = 0;
+    size_t n = (st->limit + cs - 1) / cs < mr->width ? (st->limit + cs - 1) / cs : mr->width;
+    for (size_t c = 0; st->heat && c < n; ++c) {
+        if (st->heat->dist[mr->y * mr->width + c] == MAZE_UNREACHABLE) continue;
+        unsigned mask = cell_mask(mr, north, c);
+        if ((cls == ROW_TOP && (mask & MASK_UP)) || (cls == ROW_BOTTOM && (mask & MASK_DOWN))) continue;
+        size_t lo = c * cs + (mask & MASK_LEFT ? T : 0);
+        size_t hi = c * cs + cs - (mask & MASK_RIGHT ? T : 0);
+        if (hi > st->limit) hi = st->limit;
+        if (hi > lo) heat += hi - lo;
+    }
+    MAZE_STAT_ADD(pixels[MAZE_STATS_HEAT], heat * rows);
+}
+#endif
+
+// Fill a destination row with background
+static void blank_row(const struct RowStyle *st, uint8_t *dst) {
+    MAZE_STAT_ADD(pixels[MAZE_STATS_BG], st->limit);
+    if (st->packed) {
+        memset(dst, 0, st->row_bytes); // MAZE_INDEX_BG is 0
+    } else {
+        fill_span(dst, st->limit, &st->bg);
+    }
+}
+
+// Render the first n_rows (<= cell_size) pixel rows of a cell row; pixel row
+// r goes to dst + r * stride. Packed output needs a limit-byte scratch row.
+static void render_cell_row(const struct RowStyle *st, const MazeRow *mr, const uint64_t *north, uint8_t *dst, ptrdiff_t stride, size_t n_rows, uint8_t *scratch) {
+    size_t cs = st->cell_size, T = st->wall_thickness;
+    size_t bounds[4] = { 0, T, cs - T, cs };
+
+    for (int cls = ROW_TOP; cls <= ROW_BOTTOM; ++cls) {
+        size_t r0 = bounds[cls], r1 = bounds[cls + 1] < n_rows ? bounds[cls + 1] : n_rows;
+        if (r0 >= r1) continue;
+        uint8_t *first = dst + (ptrdiff_t)r0 * stride;
+        if (st->packed) {
+            build_scanline(scratch, st, mr, north, (enum RowClass)cls);
+            pack_bits(first, scratch, st->limit);
+        } else {
+            build_scanline(first, st, mr, north, (enum RowClass)cls);
+        }
+        for (size_t r = r0 + 1; r < r1; ++r) {
+            memcpy(dst + (ptrdiff_t)r * stride, first, st->row_bytes);
+        }
+#ifdef MAZE_STATS
+        count_scanline(st, mr, north, (enum RowClass)cls, r1 - r0);
+#endif
+    }
+}
+
+// Paint the inset of a cell, clipped to pixels [x0, x1) x [y0, y1) of the
+// image; `pixels` holds pixel (x0, y0)
+static void fill_marker(uint8_t *pixels, ptrdiff_t stride, size_t x0, size_t x1, size_t y0, size_t y1, size_t cs, size_t T, Point cell, const struct Fill *f) {
+    size_t mx0 = cell.x * cs + T, mx1 = (cell.x + 1) * cs - T;
+    size_t my0 = cell.y * cs + T, my1 = (cell.y + 1) * cs - T;
+    if (mx0 < x0) mx0 = x0;
+    if (mx1 > x1) mx1 = x1;
+    if (my0 < y0) my0 = y0;
+    if (my1 > y1) my1 = y1;
+    if (my0 < my1 && mx0 < mx1) MAZE_STAT_ADD(pixels[f->stat], (my1 - my0) * (mx1 - mx0));
+    for (size_t y = my0; y < my1 && mx0 < mx1; ++y) {
+        fill_span(pixels + (ptrdiff_t)(y - y0) * stride + (mx0 - x0) * f->bytes, mx1 - mx0, f);
+    }
+}
+
+// Paint the start and end markers over pixel rows [y0, y1) of rows that start
+// at pixel x0; 1-bit output has no palette entries for them
+static void fill_markers(const struct RowStyle *st, uint8_t *pixels, ptrdiff_t stride, size_t x0, size_t y0, size_t y1, const MazeRenderConfig *cfg, Point start, Point end) {
+    if (!cfg->markers || st->packed) return;
+
+    fill_marker(pixels, stride, x0, x0 + st->limit, y0, y1, st->cell_size, st->wall_thickness, start, &st->start);
+    fill_marker(pixels, stride, x0, x0 + st->limit, y0, y1, st->cell_size, st->wall_thickness, end, &st->end);
+}
+
+void maze_render_marker(BmpImage *img, uint32_t cell_size, uint32_t wall_thickness, Point cell, RGBTriple color) {
+    if (!img || img->infoHeader.biBitCount != 24) return;
+
+    struct Fill f;
+    fill_init(&f, &color, sizeof(RGBTriple), MAZE_STATS_MARKER);
+    size_t width = img->infoHeader.biWidth, height = abs(img->infoHeader.biHeight);
+    fill_marker((uint8_t *)img->pixels, img->stride, 0, width, 0, height, cell_size, wall_thickness, cell, &f);
+}
+
+void maze_render_config_init(MazeRenderConfig *cfg, const Maze *m) {
+    if (!cfg) return;
+
+    cfg->cell_size = m ? m->cell_size : 0;
+    cfg->wall_thickness = m ? m->wall_thickness : 0;
+    cfg->bg_color = MAZE_BG_COLOR;
+    cfg->wall_color = MAZE_WALL_COLOR;
+    cfg->start_color = MAZE_START_COLOR;
+    cfg->end_color = MAZE_END_COLOR;
+    cfg->path_color = MAZE_PATH_COLOR;
+    cfg->bit_count = 24;
+    cfg->markers = true;
+    cfg->heatmap = NULL;
+}
+
+void maze_render_format(const MazeRenderConfig *cfg, BmpFormat *fmt) {
+    if (!cfg || !fmt) return;
+
+    fmt->bit_count = cfg->bit_count;
+    fmt->n_colors = cfg->bit_count == 24 ? 0 : cfg->bit_count == 1 ? 2 : cfg->heatmap ? 256 : 5;
+    fmt->palette[MAZE_INDEX_BG] = cfg->bg_color;
+    fmt->palette[MAZE_INDEX_WALL] = cfg->wall_color;
+    fmt->palette[MAZE_INDEX_START] = cfg->start_color;
+    fmt->palette[MAZE_INDEX_END] = cfg->end_color;
+    fmt->palette[MAZE_INDEX_PATH] = cfg->path_color;
+    for (size_t i = 0; cfg->heatmap && i < HEAT_LEVELS; ++i) {
+        fmt->palette[MAZE_INDEX_HEAT + i] = heat_color(i);
+    }
+}
+
+void maze_render_markers(BmpImage *img, const MazeRenderConfig *cfg, Point start, Point end) {
+    if (!img || !cfg) return;
+
+    struct RowStyle st;
+    if (style_init(&st, cfg, img->infoHeader.biWidth, img->infoHeader.biBitCount)) {
+        fill_markers(&st, (uint8_t *)img->pixels, img->stride, 0, 0, abs(img->infoHeader.biHeight), cfg, start, end);
+    }
+    style_free(&st);
+}
+
+// Paint pixels [x0, x1) x [y0, y1) of a width x height image, clipped to it
+static void fill_rect(uint8_t *pixels, ptrdiff_t stride, size_t width, size_t height, size_t x0, size_t x1, size_t y0, size_t y1, const struct Fill *f) {
+    if (x1 > width) x1 = width;
+    if (y1 > height) y1 = height;
+    if (y0 < y1 && x0 < x1) MAZE_STAT_ADD(pixels[f->stat], (y1 - y0) * (x1 - x0));
+    for (size_t y = y0; y < y1 && x0 < x1; ++y) {
+        fill_span(pixels + (ptrdiff_t)y * stride + x0 * f->bytes, x1 - x0, f);
+    }
+}
+
+void maze_render_path(BmpImage *img, const MazeRenderConfig *cfg, const Maze *m, const MazeSolution *solution) {
+    if (!img || !cfg || !m || !solution || !solution->path) return;
+
+    size_t width = img->infoHeader.biWidth, height = abs(img->infoHeader.biHeight);
+    size_t cs = cfg->cell_size, T = cfg->wall_thickness;
+    uint8_t *pixels = (uint8_t *)img->pixels;
+    struct RowStyle st;
+    if (style_init(&st, cfg, width, img->infoHeader.biBitCount) && !st.packed) {
+        // Only the set bits are visited: the path is a thin line through the grid
+        for (size_t y = 0; y < m->height; ++y) {
+            const uint64_t *bits = solution->path + y * solution->row_words;
+            for (size_t w = 0; w < solution->row_words; ++w) {
+                for (uint64_t word = bits[w]; word; word &= word - 1) {
+                    size_t x = w * 64 + (size_t)__builtin_ctzll(word);
+                    size_t px = x * cs, py = y * cs;
+                    bool marker = cfg->markers && ((x == (size_t)m->start.x && y == (size_t)m->start.y) ||
+                                                   (x == (size_t)m->end.x && y == (size_t)m->end.y));
+                    if (!marker) {
+                        fill_rect(pixels, img->stride, width, height, px + T, px + cs - T, py + T, py + cs - T, &st.path);
+                    }
+                    // Bridge the opening to the next path cell east and south
+                    if (x + 1 < m->width && maze_on_path(solution, x + 1, y) && !maze_has_wall(m, maze_cell_index(m, x, y), RIGHT)) {
+                        fill_rect(pixels, img->stride, width, height, px + cs - T, px + cs + T, py + T, py + cs - T, &st.path);
+                    }
+                    if (y + 1 < m->height && maze_on_path(solution, x, y + 1) && !maze_has_wall(m, maze_cell_index(m, x, y), DOWN)) {
+                        fill_rect(pixels, img->stride, width, height, px + T, px + cs - T, py + cs - T, py + cs + T, &st.path);
+                    }
+                }
+            }
+        }
+    }
+    style_free(&st);
+}
+
+#define BANDS_PER_WORKER 8 // Extra bands even out rows that render at different speeds
+
+// One parallel render of cell rows [cy0, cy1); task b draws band_rows of
+// them starting at cy0 + b * band_rows
+struct BandJob {
+    const Maze *m;
+    const struct RowStyle *st;
+    uint8_t *pixels; // Holds pixel row cy0 * cell_size
+    ptrdiff_t stride;
+    size_t height; // Pixel rows of the image
+    size_t cy0, cy1;
+    size_t band_rows; // Cell rows per band
+    uint8_t *scratch; // One limit-byte scratch row per worker, for packed output
+};
+
+// Bands cover disjoint pixel rows, so workers never write to the same bytes
+static void render_band(void *ctx, size_t task, unsigned worker) {
+    const struct BandJob *job = ctx;
+    const Maze *m = job->m;
+    size_t cs = job->st->cell_size;
+    size_t first = job->cy0 + task * job->band_rows;
+    size_t last = first + job->band_rows < job->cy1 ? first + job->band_rows : job->cy1;
+
+    struct MazeRow row;
+    for (size_t cy = first; cy < last && cy * cs < job->height; ++cy) {
+        size_t y = cy * cs;
+        maze_get_row(m, cy, &row);
+        render_cell_row(job->st, &row, cy > 0 ? maze_row_south(m, cy - 1) : NULL,
+                        job->pixels + (ptrdiff_t)(y - job->cy0 * cs) * job->stride, job->stride,
+                        job->height - y < cs ? job->height - y : cs,
+                        job->scratch ? job->scratch + worker * job->st->limit : NULL);
+    }
+}
+
+void maze_render_to_bmp(const Maze *m, BmpImage *img, const MazeRenderConfig *cfg, ThreadPool *pool) {
+    if (!m || !img) return;
+
+    MazeRenderConfig defaults;
+    if (!cfg) {
+        maze_render_config_init(&defaults, m);
+        cfg = &defaults;
+    }
+
+    size_t width = img->infoHeader.biWidth, height = abs(img->infoHeader.biHeight);
+    size_t cs = cfg->cell_size;
+    ptrdiff_t stride = img->stride;
+    uint8_t *pixels = (uint8_t *)img->pixels;
+
+    struct RowStyle st;
+    unsigned workers = threadpool_size(pool);
+    bool ok = style_init(&st, cfg, width, img->infoHeader.biBitCount);
+    struct BandJob job = { m, &st, pixels, stride, height, 0, m->height, 0, NULL };
+    if (ok && st.packed) {
+        job.scratch = malloc(workers * width);
+        ok = job.scratch != NULL;
+    }
+
+    if (ok) {
+        size_t bands = (size_t)workers * BANDS_PER_WORKER;
+        job.band_rows = (m->height + bands - 1) / bands;
+        threadpool_run(pool, (m->height + job.band_rows - 1) / job.band_rows, render_band, &job);
+
+        // Pixel rows below the maze
+        for (size_t y = m->height * cs; y < height; ++y) {
+            blank_row(&st, pixels + (ptrdiff_t)y * stride);
+        }
+
+        // Color start and end cells
+        fill_markers(&st, pixels, stride, 0, 0, height, cfg, m->start, m->end);
+    }
+    free(job.scratch);
+    style_free(&st);
+}
+
+bool maze_render_to_file(const Maze *m, const char *filename, const MazeRenderConfig *cfg, ThreadPool *pool) {
+    if (!m || !filename) return false;
+
+    MazeRenderConfig defaults;
+    if (!cfg) {
+        maze_render_config_init(&defaults, m);
+        cfg = &defaults;
+    }
+
+    size_t cs = cfg->cell_size;
+    size_t width = m->width * cs, height = m->height * cs;
+    BmpFormat fmt;
+    maze_render_format(cfg, &fmt);
+
+    // A band is one cell row per worker; only one band is ever in memory
+    size_t band_cells = threadpool_size(pool);
+    struct RowStyle st;
+    bool ok = style_init(&st, cfg, width, cfg->bit_count);
+    ptrdiff_t stride = st.row_bytes;
+    uint8_t *band = ok ? malloc(band_cells * cs * stride) : NULL;
+    uint8_t *scratch = ok && st.packed ? malloc(band_cells * width) : NULL;
+    ok = band && (scratch || !st.packed);
+    BmpWriter *w = ok ? bmp_writer_open(filename, (int)width, (int)height, false, &fmt) : NULL;
+    ok = ok && w;
+
+    // The file stores the bottom row first, so bands are rendered bottom-up
+    // and each is written with its rows reversed
+    struct BandJob job = { m, &st, band, stride, height, 0, 0, 1, scratch };
+    for (size_t cy1 = m->height; ok && cy1 > 0; cy1 = job.cy0) {
+        job.cy0 = cy1 > band_cells ? cy1 - band_cells : 0;
+        job.cy1 = cy1;
+        threadpool_run(pool, cy1 - job.cy0, render_band, &job);
+
+        size_t y0 = job.cy0 * cs, n_rows = (cy1 - job.cy0) * cs;
+        fill_markers(&st, band, stride, 0, y0, y0 + n_rows, cfg, m->start, m->end);
+        ok = bmp_writer_write_rows(w, band + (ptrdiff_t)(n_rows - 1) * stride, (int)n_rows, -stride);
+    }
+
+    if (w && !bmp_writer_close(w)) ok = false;
+    style_free(&st);
+    free(band);
+    free(scratch);
+    return ok;
+}
+
+void maze_render_row(const struct MazeRow *row, const uint64_t *north, const MazeRenderConfig *cfg, struct BmpImage *img) {
+    if (!row || !cfg || !img) return;
+
+    size_t width = img->infoHeader.biWidth, height = abs(img->infoHeader.biHeight);
+    size_t cs = cfg->cell_size;
+    size_t y = row->y * cs;
+    if (y >= height) return;
+
+    struct RowStyle st;
+    uint8_t *scratch = NULL;
+    if (style_init(&st, cfg, width, img->infoHeader.biBitCount) &&
+        (!st.packed || (scratch = malloc(width)) != NULL)) {
+        render_cell_row(&st, row, north, (uint8_t *)bmp_row(img, (int)y), img->stride,
+                        height - y < cs ? height - y : cs, scratch);
+    }
+    free(scratch);
+    style_free(&st);
+}
+
+// Rows from a streaming generator, rendered one cell row at a time into a
+// top-down file; only that cell row and the previous south walls are kept
+struct MazeRenderStream {
+    BmpWriter *writer;
+    MazeRenderConfig cfg;
+    struct RowStyle st;
+    uint8_t *rows; // cell_size pixel rows
+    uint8_t *scratch; // Scanline of palette indices, for packed output
+    uint64_t *north; // South walls of the previous cell row
+    size_t height; // Cell rows
+    Point start, end;
+    bool ok;
+};
+
+struct MazeRenderStream *maze_render_stream_open(const char *filename, size_t width, size_t height, const MazeRenderConfig *cfg, Point start, Point end) {
+    if (!filename || !cfg || width == 0 || height == 0) return NULL;
+
+    struct MazeRenderStream *rs = calloc(1, sizeof(struct MazeRenderStream));
+    if (!rs) return NULL;
+
+    size_t cs = cfg->cell_size;
+    rs->cfg = *cfg;
+    rs->height = height;
+    rs->start = start;
+    rs->end = end;
+    BmpFormat fmt;
+    maze_render_format(cfg, &fmt);
+    rs->ok = style_init(&rs->st, &rs->cfg, width * cs, cfg->bit_count);
+    if (rs->ok) {
+        rs->rows = malloc(cs * rs->st.row_bytes);
+        rs->scratch = rs->st.packed ? malloc(width * cs) : NULL;
+        rs->north = malloc((width + 63) / 64 * sizeof(uint64_t));
+        rs->ok = rs->rows && rs->north && (rs->scratch || !rs->st.packed);
+    }
+    if (rs->ok) {
+        rs->writer = bmp_writer_open(filename, (int)(width * cs), (int)(height * cs), true, &fmt);
+    }
+    if (!rs->writer) {
+        maze_render_stream_close(rs);
+        return NULL;
+    }
+    return rs;
+}
+
+bool maze_render_stream_row(const struct MazeRow *row, void *stream) {
+    struct MazeRenderStream *rs = stream;
+    size_t cs = rs->cfg.cell_size;
+    ptrdiff_t stride = rs->st.row_bytes;
+
+    render_cell_row(&rs->st, row, row->y > 0 ? rs->north : NULL, rs->rows, stride, cs, rs->scratch);
+    fill_markers(&rs->st, rs->rows, stride, 0, row->y * cs, (row->y + 1) * cs, &rs->cfg, rs->start, rs->end);
+    memcpy(rs->north, row->south, row->row_words * sizeof(uint64_t));
+
+    rs->ok = rs->ok && bmp_writer_write_rows(rs->writer, rs->rows, (int)cs, stride);
+    return rs->ok;
+}
+
+bool maze_render_stream_close(struct MazeRenderStream *rs) {
+    if (!rs) return false;
+
+    bool ok = rs->ok;
+    if (rs->writer && !bmp_writer_close(rs->writer)) ok = false;
+    style_free(&rs->st);
+    free(rs->rows);
+    free(rs->scratch);
+    free(rs->north);
+    free(rs);
+    return ok;
+}
+
+// Build pixels [x0, x1) of a scanline of the given class into `row`, which
+// holds pixel x0; pixels past the right edge of the maze are background. The
+// scanline is written `rows` times, which is what the stats count.
+static void build_window_scanline(uint8_t *row, const struct RowStyle *st, const MazeRow *mr, const uint64_t *north, enum RowClass cls, size_t x0, size_t x1, size_t rows) {
+    size_t cs = st->cell_size, pb = st->pixel_bytes;
+    size_t end = mr->width * cs < x1 ? mr->width * cs : x1;
+#ifdef MAZE_STATS
+    size_t T = st->wall_thickness;
+    uint64_t wall = 0;
+#endif
+
+    size_t x = x0;
+    while (x < end) {
+        // The part of cell cx inside the window, from pixel `off` of its tile
+        size_t cx = x / cs, off = x - cx * cs;
+        size_t n = cs - off < end - x ? cs - off : end - x;
+        unsigned mask = cell_mask(mr, north, cx);
+        memcpy(row + (x - x0) * pb, atlas_row(st, mask, cls) + off * pb, n * pb);
+#ifdef MAZE_STATS
+        if ((cls == ROW_TOP && (mask & MASK_UP)) || (cls == ROW_BOTTOM && (mask & MASK_DOWN))) {
+            wall += n;
+        } else {
+            if ((mask & MASK_LEFT) && off < T) wall += (off + n < T ? off + n : T) - off;
+            if ((mask & MASK_RIGHT) && off + n > cs - T) wall += off + n - (off > cs - T ? off : cs - T);
+        }
+#endif
+        x += n;
+    }
+    if (x < x1) fill_span(row + (x - x0) * pb, x1 - x, &st->bg);
+#ifdef MAZE_STATS
+    MAZE_STAT_ADD(pixels[MAZE_STATS_WALL], wall * rows);
+    MAZE_STAT_ADD(pixels[MAZE_STATS_BG], (x1 - x0 - wall) * rows);
+#else
+    (void)rows;
+#endif
+}
+
+void maze_render_window(const struct MazeRow *rows, size_t n_rows, const uint64_t *north, const MazeRenderConfig *cfg, Point start, Point end, size_t x0, size_t y0, BmpImage *img) {
+    if (!rows || n_rows == 0 || !cfg || !img) return;
+
+    size_t width = img->infoHeader.biWidth, height = abs(img->infoHeader.biHeight);
+    size_t cs = cfg->cell_size, T = cfg->wall_thickness;
+    uint8_t *pixels = (uint8_t *)img->pixels;
+    struct RowStyle st;
+    uint8_t *scratch = NULL;
+    if (style_init(&st, cfg, width, img->infoHeader.biBitCount) &&
+        (!st.packed || (scratch = malloc(width)) != NULL)) {
+        for (size_t i = 0; i < n_rows; ++i) {
+            size_t py = rows[i].y * cs;
+            size_t bounds[4] = { py, py + T, py + cs - T, py + cs };
+            const uint64_t *above = i > 0 ? rows[i - 1].south : north;
+
+            for (int cls = ROW_TOP; cls <= ROW_BOTTOM; ++cls) {
+                // The stripe's pixel rows inside the window
+                size_t r0 = bounds[cls] > y0 ? bounds[cls] : y0;
+                size_t r1 = bounds[cls + 1] < y0 + height ? bounds[cls + 1] : y0 + height;
+                if (r0 >= r1) continue;
+                uint8_t *first = pixels + (ptrdiff_t)(r0 - y0) * img->stride;
+                if (st.packed) {
+                    build_window_scanline(scratch, &st, &rows[i], above, (enum RowClass)cls, x0, x0 + width, r1 - r0);
+                    pack_bits(first, scratch, width);
+                } else {
+                    build_window_scanline(first, &st, &rows[i], above, (enum RowClass)cls, x0, x0 + width, r1 - r0);
+                }
+                for (size_t r = r0 + 1; r < r1; ++r) {
+                    memcpy(pixels + (ptrdiff_t)(r - y0) * img->stride, first, st.row_bytes);
+                }
+            }
+        }
+        fill_markers(&st, pixels, img->stride, x0, y0, y0 + height, cfg, start, end);
+    }
+    free(scratch);
+    style_free(&st);
+}
+
+// The pixels a region's cells cover in a full render, and its cell rows.
+// Only those pixels depend on walls inside the region: the border walls are
+// drawn from bits the region does not change. 1-bit rows are widened to whole
+// bytes, which redraws a few unchanged pixels on either side.
+struct RegionWindow {
+    size_t x0, x1, y0, y1; // Pixel rectangle
+    MazeRow *rows; // Cell rows [region->y0, region->y1)
+    const uint64_t *north; // South walls of the row above, NULL for row 0
+};
+
+static bool region_window_init(struct RegionWindow *w, const Maze *m, const MazeRenderConfig *cfg, const MazeRegion *r) {
+    if (r->x0 >= r->x1 || r->y0 >= r->y1 || r->x1 > m->width || r->y1 > m->height) return false;
+
+    size_t cs = cfg->cell_size, width = m->width * cs;
+    w->x0 = r->x0 * cs;
+    w->x1 = r->x1 * cs;
+    w->y0 = r->y0 * cs;
+    w->y1 = r->y1 * cs;
+    if (cfg->bit_count == 1) {
+        w->x0 &= ~(size_t)7;
+        w->x1 = (w->x1 + 7) & ~(size_t)7;
+        if (w->x1 > width) w->x1 = width;
+    }
+    w->north = r->y0 > 0 ? maze_row_south(m, r->y0 - 1) : NULL;
+    w->rows = malloc((r->y1 - r->y0) * sizeof(MazeRow));
+    if (!w->rows) return false;
+    for (size_t y = r->y0; y < r->y1; ++y) {
+        maze_get_row(m, y, &w->rows[y - r->y0]);
+    }
+    return true;
+}
+
+void maze_render_region(const Maze *m, const MazeRenderConfig *cfg, const MazeRegion *region, BmpImage *img) {
+    if (!m || !region || !img) return;
+
+    MazeRenderConfig defaults;
+    if (!cfg) {
+        maze_render_config_init(&defaults, m);
+        cfg = &defaults;
+    }
+    if ((size_t)img->infoHeader.biWidth != m->width * cfg->cell_size ||
+        (size_t)abs(img->infoHeader.biHeight) != m->height * cfg->cell_size ||
+        img->infoHeader.biBitCount != cfg->bit_count) return;
+
+    struct RegionWindow w;
+    if (!region_window_init(&w, m, cfg, region)) return;
+
+    // Render straight into the image through a view of the window
+    BmpImage view = *img;
+    view.pixels = (RGBTriple *)((uint8_t *)bmp_row(img, (int)w.y0) + w.x0 * cfg->bit_count / 8);
+    view.infoHeader.biWidth = (int32_t)(w.x1 - w.x0);
+    view.infoHeader.biHeight = (int32_t)(w.y1 - w.y0);
+    maze_render_window(w.rows, region->y1 - region->y0, w.north, cfg, m->start, m->end, w.x0, w.y0, &view);
+    free(w.rows);
+}
+
+bool maze_render_region_to_file(const Maze *m, const char *filename, const MazeRenderConfig *cfg, const MazeRegion *region) {
+    if (!m || !filename || !region) return false;
+
+    MazeRenderConfig defaults;
+    if (!cfg) {
+        maze_render_config_init(&defaults, m);
+        cfg = &defaults;
+    }
+
+    struct RegionWindow w;
+    if (!region_window_init(&w, m, cfg, region)) return false;
+
+    BmpFormat fmt;
+    maze_render_format(cfg, &fmt);
+    BmpImage *img = bmp_create_format((int)(w.x1 - w.x0), (int)(w.y1 - w.y0), &fmt);
+    bool ok = img != NULL;
+    if (ok) {
+        maze_render_window(w.rows, region->y1 - region->y0, w.north, cfg, m->start, m->end, w.x0, w.y0, img);
+        ok = bmp_write_rect(filename, img, (int)w.x0, (int)w.y0);
+    }
+    bmp_free(img);
+    free(w.rows);
+    return ok;
+}
+
+// Draw a cell's background and a stripe of thickness T for each wall present
+static void render_cell_walls(BmpImage *img, int x0, int y0, int cs, int T, bool up, bool right, bool down, bool left) {
+    int x1 = x0 + cs - 1;
+    int y1 = y0 + cs - 1;
+    MAZE_STAT_ADD(pixels[MAZE_STATS_BG], (uint64_t)cs * cs);
+    MAZE_STAT_ADD(pixels[MAZE_STATS_WALL], (uint64_t)T * cs * (up + right + down + left));
+
+    // Fill background
+    for (int y = y0; y <= y1; ++y){
+        for (int x = x0; x <= x1; ++x) {
+            bmp_set_pixel(img, x, y, MAZE_BG_COLOR);
+        }
+    }
+
+    // Draw each wall as a stripe of thickness T
+    if (up) {
+        for (int t = 0; t < T; ++t) {
+            for (int x = x0; x <= x1; ++x) {
+                bmp_set_pixel(img, x, y0 + t, MAZE_WALL_COLOR);
+            }
+        }
+    }
+
+    if (down) {
+        for (int t = 0; t < T; ++t) {
+            for (int x = x0; x <= x1; ++x) {
+                 bmp_set_pixel(img, x, y1 - t, MAZE_WALL_COLOR);
+            }
+        }
+    }
+
+    if (left) {
+        for (int t = 0; t < T; ++t) {
+            for (int y = y0; y <= y1; ++y) {
+                bmp_set_pixel(img, x0 + t, y, MAZE_WALL_COLOR);
+            }
+        }
+    }
+
+    if (right) {
+        for (int t = 0; t < T; ++t) {
+            for (int y = y0; y <= y1; ++y) {
+                bmp_set_pixel(img, x1 - t, y, MAZE_WALL_COLOR);
+            }
+        }
+    }
+}
+
+void maze_render_cell(const struct Maze *m, struct BmpImage *img, size_t cell) {
+    int cs = m->cell_size, T = m->wall_thickness;
+    Point pos = maze_cell_position(m, cell);
+    render_cell_walls(img, pos.x * cs, pos.y * cs, cs, T,
+                      maze_has_wall(m, cell, UP), maze_has_wall(m, cell, RIGHT),
+                      maze_has_wall(m, cell, DOWN), maze_has_wall(m, cell, LEFT));
+}
@@ -0,0 +1,101 @@
+#ifndef MAZE_RENDER_H
+#define MAZE_RENDER_H
+
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t
+
+#include "../bmp/bmp.h"
+#include "../maze_generator/maze_generator.h"
+#include "../maze_solver/maze_solver.h"
+
+extern struct RGBTriple MAZE_START_COLOR; // default {0,255,0}
+extern struct RGBTriple MAZE_END_COLOR;   // default {255,0,0}
+extern struct RGBTriple MAZE_WALL_COLOR;  // default {0,0,0}
+extern struct RGBTriple MAZE_BG_COLOR;    // default {255,255,255}
+extern struct RGBTriple MAZE_PATH_COLOR;  // default {0,0,255}
+
+// Geometry and colors of one render. Renderers only read it, so a single
+// config is shared by all the threads of a parallel render.
+struct MazeRenderConfig {
+    uint32_t cell_size;
+    uint32_t wall_thickness;
+    struct RGBTriple bg_color;
+    struct RGBTriple wall_color;
+    struct RGBTriple start_color;
+    struct RGBTriple end_color;
+    struct RGBTriple path_color; // Solution path, see maze_render_path
+    int bit_count; // Depth of files the renderer creates: 24, 8 (indexed) or 1 (indexed, no markers)
+    bool markers; // Draw the start and end cells
+    const struct MazeDistances *heatmap; // If set, open cell pixels are colored along a gradient by distance (24- and 8-bit)
+};
+
+// Palette of indexed output; see maze_render_format
+enum MazePaletteIndex {
+    MAZE_INDEX_BG,
+    MAZE_INDEX_WALL,
+    MAZE_INDEX_START,
+    MAZE_INDEX_END,
+    MAZE_INDEX_PATH,
+    MAZE_INDEX_HEAT // First of the heatmap gradient entries, which run to 255
+};
+
+// The renderer builds every output scanline as horizontal spans of one color.
+// Within a cell row only three scanlines differ (the north wall stripe, the
+// cell interiors and the south wall stripe), so each is built once and copied
+// to the other pixel rows of its stripe. Every wall bit is read once per row.
+// Whole-maze renders split the image into bands of cell rows, one task each.
+
+void maze_render_config_init(struct MazeRenderConfig *cfg, const struct Maze *m); // Geometry of m, colors from the MAZE_*_COLOR globals, 24-bit with markers
+
+void maze_render_format(const struct MazeRenderConfig *cfg, struct BmpFormat *fmt); // Image format for cfg->bit_count, with the palette of indexed output
+
+void maze_render_to_bmp(const struct Maze *m, struct BmpImage *img, const struct MazeRenderConfig *cfg, struct ThreadPool *pool); // Draw the maze to a 24-, 8- or 1-bit BMP image in parallel bands (NULL cfg: maze_render_config_init, NULL pool: one thread)
+
+void maze_render_cell(const struct Maze *m, struct BmpImage *img, size_t cell); // Draw a cell at its pixel coordinates
+
+bool maze_render_to_file(const struct Maze *m, const char *filename, const struct MazeRenderConfig *cfg, struct ThreadPool *pool); // Render straight to a BMP file one band of cell rows at a time; memory is O(image width x cell size)
+
+struct MazeRenderStream; // Renders generator rows straight to a file, see maze_render.c
+
+struct MazeRenderStream *maze_render_stream_open(const char *filename, size_t width, size_t height, const struct MazeRenderConfig *cfg, struct Point start, struct Point end); // Start a top-down BMP file for a width x height cell maze
+
+bool maze_render_stream_row(const struct MazeRow *row, void *stream); // Render and write the next cell row; a MazeRowCallback
+
+bool maze_render_stream_close(struct MazeRenderStream *rs); // Finish the file; false if any row failed or rows are missing
+
+void maze_render_row(const struct MazeRow *row, const uint64_t *north, const struct MazeRenderConfig *cfg, struct BmpImage *img); // Draw one cell row; north holds the south wall bits of the row above (NULL for row 0)
+
+void maze_render_window(const struct MazeRow *rows, size_t n_rows, const uint64_t *north, const struct MazeRenderConfig *cfg, struct Point start, struct Point end, size_t x0, size_t y0, struct BmpImage *img); // Draw the image-sized window at pixel (x0, y0) from consecutive cell rows covering it; north holds the south walls above rows[0] (NULL for row 0). No heatmap
+
+void maze_render_region(const struct Maze *m, const struct MazeRenderConfig *cfg, const struct MazeRegion *region, struct BmpImage *img); // Redraw only the pixels of a region's cells in a full render of m, e.g. after maze_regenerate_region (NULL cfg: maze_render_config_init); no heatmap or path
+
+bool maze_render_region_to_file(const struct Maze *m, const char *filename, const struct MazeRenderConfig *cfg, const struct MazeRegion *region); // Rewrite in place only the pixels of a region's cells in a BMP file holding a full render of m; memory and writes are O(region pixels)
+
+struct MazeTiles; // Deep-zoom tile pyramid written from generator rows, see maze_tiles.c
+
+struct MazeTiles *maze_tiles_open(const char *name, size_t width, size_t height, const struct MazeRenderConfig *cfg, struct Point start, struct Point end, uint32_t tile_size, struct ThreadPool *pool); // Start name.dzi and name_files/ for a width x height cell maze; tiles are 24-bit PNGs
+
+bool maze_tiles_row(const struct MazeRow *row, void *tiles); // Take the next cell row, writing every tile it completes; a MazeRowCallback
+
+bool maze_tiles_close(struct MazeTiles *t); // Write the remaining tiles; false if any tile failed or rows are missing
+
+bool maze_render_tiles(const struct Maze *m, const char *name, const struct MazeRenderConfig *cfg, uint32_t tile_size, struct ThreadPool *pool); // Render a maze as a deep-zoom pyramid; memory is O(image width x tile size)
+
+struct MazePreview; // Reduced-size image summed from generator rows, see maze_preview.c
+
+struct MazePreview *maze_preview_open(size_t width, size_t height, const struct MazeRenderConfig *cfg, struct Point start, struct Point end, size_t preview_width); // Start a preview at most preview_width pixels wide (and one pixel per cell) of a width x height cell maze
+
+bool maze_preview_row(const struct MazeRow *row, void *preview); // Add the next cell row; a MazeRowCallback
+
+struct BmpImage *maze_preview_close(struct MazePreview *p); // The finished 24-bit preview, or NULL if rows are missing; frees p
+
+struct BmpImage *maze_render_preview(const struct Maze *m, const struct MazeRenderConfig *cfg, size_t preview_width, struct ThreadPool *pool); // Preview of a whole maze, pixel rows in parallel; each pixel is the average color of the full render over its block of cells, from wall-bit counts alone
+
+void maze_render_marker(struct BmpImage *img, uint32_t cell_size, uint32_t wall_thickness, struct Point cell, struct RGBTriple color); // Fill the inside of a cell with a marker color (24-bit images)
+
+void maze_render_path(struct BmpImage *img, const struct MazeRenderConfig *cfg, const struct Maze *m, const struct MazeSolution *solution); // Draw a solution path over a rendered maze (24- and 8-bit images); start and end keep their markers
+
+void maze_render_markers(struct BmpImage *img, const struct MazeRenderConfig *cfg, struct Point start, struct Point end); // Draw the start and end markers of cfg in the image's own format
+
+#endif // MAZE_RENDER_H
@@ -0,0 +1,304 @@
+#include "maze_render.h"
+#include "../png/png.h"
+
+#include <errno.h>     // for errno, EEXIST
+#include <stdatomic.h> // for atomic_bool
+#include <stdio.h>     // for FILE, fopen, fprintf, snprintf
+#include <stdlib.h>    // for malloc, calloc, free
+#include <string.h>    // for memcpy, memmove, strlen
+
+#ifdef _WIN32
+#include <direct.h>   // for _mkdir
+#else
+#include <sys/stat.h> // for mkdir
+#endif
+
+typedef struct BmpImage BmpImage;
+typedef struct Point Point;
+typedef struct Maze Maze;
+typedef struct MazeRow MazeRow;
+typedef struct MazeRenderConfig MazeRenderConfig;
+typedef struct MazeTiles MazeTiles;
+typedef struct ThreadPool ThreadPool;
+
+#define MIN_TILE_SIZE 16
+#define MAX_TILE_SIZE 8192
+
+// One level of the pyramid. Level 0 is a single pixel and each level above
+// doubles it, up to the full-size render at the top. Tiles are written one
+// band (a row of tiles) at a time, top to bottom.
+struct TileLevel {
+    size_t width, height; // in pixels
+    size_t band; // Band of tiles being filled
+    uint8_t *pixels; // Below the top: the band, tile_size rows of width BGR pixels
+};
+
+// The top level is rendered straight from the cell rows that cover its
+// current band. Each of its tiles is halved into the band of the level below,
+// which fills up every two bands and is then written and halved in turn. So
+// apart from the tiles themselves only a few cell rows and one band per level
+// are ever in memory.
+struct MazeTiles {
+    char *name; // Output prefix: name.dzi and name_files/
+    MazeRenderConfig cfg;
+    Point start, end;
+    size_t width, height; // in cells
+    size_t tile; // Tile size in pixels
+    ThreadPool *pool;
+    int top; // Level of the full-size render
+    struct TileLevel *levels;
+    MazeRow *rows; // Cell rows covering the top level's band
+    uint64_t *bits; // East then south walls of each buffered row
+    size_t n_rows, max_rows;
+    uint64_t *north; // South walls of the row above rows[0]
+    size_t next_y; // Cell row expected next
+    BmpImage **images; // One tile image per worker
+    char *paths; // One path buffer per worker
+    size_t path_size; // Bytes per path buffer
+    int level; // Level whose band the running job writes
+    atomic_bool failed; // A tile could not be written
+    bool ok;
+};
+
+static bool make_dir(const char *path) {
+#ifdef _WIN32
+    return _mkdir(path) == 0 || errno == EEXIST;
+#else
+    return mkdir(path, 0777) == 0 || errno == EEXIST;
+#endif
+}
+
+// Halve a w x h BGR block by averaging 2x2 pixels; an odd last row or column
+// is averaged with itself
+static void downsample(const uint8_t *src, ptrdiff_t src_stride, size_t w, size_t h, uint8_t *dst, ptrdiff_t dst_stride) {
+    for (size_t y = 0; y < (h + 1) / 2; ++y) {
+        const uint8_t *a = src + (ptrdiff_t)(2 * y) * src_stride;
+        const uint8_t *b = 2 * y + 1 < h ? a + src_stride : a;
+        uint8_t *d = dst + (ptrdiff_t)y * dst_stride;
+        for (size_t x = 0; x < (w + 1) / 2; ++x) {
+            size_t l = 6 * x, r = 2 * x + 1 < w ? l + 3 : l;
+            for (size_t k = 0; k < 3; ++k) {
+                d[3 * x + k] = (uint8_t)((a[l + k] + a[r + k] + b[l + k] + b[r + k] + 2) / 4);
+            }
+        }
+    }
+}
+
+// Write tile `col` of the current band of t->level, then halve it into the
+// level below. Tiles of a band cover disjoint columns of the band below.
+static void write_tile(void *ctx, size_t col, unsigned worker) {
+    MazeTiles *t = ctx;
+    int l = t->level;
+    const struct TileLevel *lv = &t->levels[l];
+    size_t ts = t->tile;
+    size_t x0 = col * ts, y0 = lv->band * ts;
+    size_t w = lv->width - x0 < ts ? lv->width - x0 : ts;
+    size_t h = lv->height - y0 < ts ? lv->height - y0 : ts;
+
+    BmpImage *img = t->images[worker];
+    if (!bmp_reshape(img, (int)w, (int)h, NULL)) {
+        atomic_store(&t->failed, true);
+        return;
+    }
+    if (l == t->top) {
+        maze_render_window(t->rows, t->n_rows, t->rows[0].y > 0 ? t->north : NULL, &t->cfg, t->start, t->end, x0, y0, img);
+    } else {
+        for (size_t y = 0; y < h; ++y) {
+            memcpy(bmp_row(img, (int)y), lv->pixels + (y * lv->width + x0) * 3, w * 3);
+        }
+    }
+
+    char *path = t->paths + worker * t->path_size;
+    snprintf(path, t->path_size, "%s_files/%d/%zu_%zu.png", t->name, l, col, lv->band);
+    if (!png_save(path, img, NULL)) atomic_store(&t->failed, true);
+
+    if (l > 0) {
+        const struct TileLevel *down = &t->levels[l - 1];
+        size_t row = lv->band % 2 * (ts / 2); // Odd bands fill the lower half of the band below
+        downsample((const uint8_t *)img->pixels, img->stride, w, h,
+                   down->pixels + (row * down->width + x0 / 2) * 3, (ptrdiff_t)down->width * 3);
+    }
+}
+
+// Write the current band of level l, then every band below that it completes
+static void finish_band(MazeTiles *t, int l) {
+    for (;;) {
+        struct TileLevel *lv = &t->levels[l];
+        t->level = l;
+        threadpool_run(t->pool, (lv->width + t->tile - 1) / t->tile, write_tile, t);
+
+        // A band below is complete after its second band above, or after the last one
+        bool completes = lv->band % 2 == 1 || (lv->band + 1) * t->tile >= lv->height;
+        lv->band++;
+        if (l == 0 || !completes) return;
+        --l;
+    }
+}
+
+static bool write_dzi(const MazeTiles *t) {
+    char *path = t->paths;
+    snprintf(path, t->path_size, "%s.dzi", t->name);
+    FILE *fp = fopen(path, "w");
+    if (!fp) return false;
+
+    const struct TileLevel *top = &t->levels[t->top];
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" TileSize=\"%zu\" Overlap=\"0\" Format=\"png\">\n"
+                "  <Size Width=\"%zu\" Height=\"%zu\"/>\n"
+                "</Image>\n",
+            t->tile, top->width, top->height);
+    return fclose(fp) == 0;
+}
+
+MazeTiles *maze_tiles_open(const char *name, size_t width, size_t height, const MazeRenderConfig *cfg, Point start, Point end, uint32_t tile_size, ThreadPool *pool) {
+    if (!name || !cfg || width == 0 || height == 0 || cfg->cell_size == 0) return NULL;
+    if (tile_size < MIN_TILE_SIZE || tile_size > MAX_TILE_SIZE || tile_size % 2) return NULL;
+
+    MazeTiles *t = calloc(1, sizeof(MazeTiles));
+    if (!t) return NULL;
+
+    // Tiles are 24-bit, so levels below the top can blend colors
+    size_t cs = cfg->cell_size;
+    t->cfg = *cfg;
+    t->cfg.bit_count = 24;
+    t->cfg.heatmap = NULL;
+    t->start = start;
+    t->end = end;
+    t->width = width;
+    t->height = height;
+    t->tile = tile_size;
+    t->pool = pool;
+    t->ok = true;
+    atomic_init(&t->failed, false);
+
+    size_t pw = width * cs, ph = height * cs;
+    while (((size_t)1 << t->top) < (pw > ph ? pw : ph)) ++t->top;
+    t->levels = calloc(t->top + 1, sizeof(struct TileLevel));
+    t->ok = t->levels != NULL;
+    for (int l = t->top; t->ok && l >= 0; --l) {
+        struct TileLevel *lv = &t->levels[l];
+        lv->width = l == t->top ? pw : (t->levels[l + 1].width + 1) / 2;
+        lv->height = l == t->top ? ph : (t->levels[l + 1].height + 1) / 2;
+        if (l < t->top) {
+            lv->pixels = malloc(lv->width * tile_size * 3);
+            t->ok = lv->pixels != NULL;
+        }
+    }
+
+    // The rows covering a band: tile / cs whole ones, plus one cut at each edge
+    size_t row_words = (width + 63) / 64;
+    t->max_rows = tile_size / cs + 2;
+    t->rows = t->ok ? malloc(t->max_rows * sizeof(MazeRow)) : NULL;
+    t->bits = t->ok ? malloc(t->max_rows * 2 * row_words * sizeof(uint64_t)) : NULL;
+    t->north = t->ok ? malloc(row_words * sizeof(uint64_t)) : NULL;
+    t->ok = t->rows && t->bits && t->north;
+
+    unsigned workers = threadpool_size(pool);
+    t->name = malloc(strlen(name) + 1);
+    t->path_size = strlen(name) + 64; // Room for "_files/<level>/<col>_<row>.png"
+    t->paths = malloc(workers * t->path_size);
+    t->images = calloc(workers, sizeof(BmpImage *));
+    t->ok = t->ok && t->name && t->paths && t->images;
+    for (unsigned w = 0; t->ok && w < workers; ++w) {
+        t->images[w] = bmp_create(tile_size, tile_size);
+        t->ok = t->images[w] != NULL;
+    }
+
+    if (t->ok) {
+        memcpy(t->name, name, strlen(name) + 1);
+        snprintf(t->paths, t->path_size, "%s_files", name);
+        t->ok = make_dir(t->paths);
+        for (int l = 0; t->ok && l <= t->top; ++l) {
+            snprintf(t->paths, t->path_size, "%s_files/%d", name, l);
+            t->ok = make_dir(t->paths);
+        }
+        t->ok = t->ok && write_dzi(t);
+    }
+    if (!t->ok) {
+        maze_tiles_close(t);
+        return NULL;
+    }
+    return t;
+}
+
+bool maze_tiles_row(const MazeRow *row, void *tiles) {
+    MazeTiles *t = tiles;
+    if (!t->ok || row->y != t->next_y || row->width != t->width || t->n_rows == t->max_rows) {
+        t->ok = false;
+        return false;
+    }
+    ++t->next_y;
+
+    size_t rw = row->row_words;
+    uint64_t *bits = t->bits + t->n_rows * 2 * rw;
+    memcpy(bits, row->east, rw * sizeof(uint64_t));
+    memcpy(bits + rw, row->south, rw * sizeof(uint64_t));
+    t->rows[t->n_rows++] = (MazeRow){ row->y, row->width, rw, bits, bits + rw };
+
+    // Write every band of the top level the rows now cover; with cells
+    // larger than tiles one row can cover several
+    struct TileLevel *top = &t->levels[t->top];
+    size_t cs = t->cfg.cell_size, ts = t->tile;
+    while (t->ok && top->band * ts < top->height) {
+        size_t y1 = (top->band + 1) * ts < top->height ? (top->band + 1) * ts : top->height;
+        if ((row->y + 1) * cs < y1) break;
+        finish_band(t, t->top);
+        t->ok = !atomic_load(&t->failed);
+
+        // Drop the rows above the next band, keeping the south walls of the last
+        size_t keep = top->band * ts / cs;
+        size_t drop = 0;
+        while (drop < t->n_rows && t->rows[drop].y < keep) ++drop;
+        if (drop == 0) continue;
+        memcpy(t->north, t->rows[drop - 1].south, rw * sizeof(uint64_t));
+        t->n_rows -= drop;
+        memmove(t->bits, t->bits + drop * 2 * rw, t->n_rows * 2 * rw * sizeof(uint64_t));
+        for (size_t i = 0; i < t->n_rows; ++i) {
+            t->rows[i] = t->rows[i + drop];
+            t->rows[i].east = t->bits + i * 2 * rw;
+            t->rows[i].south = t->rows[i].east + rw;
+        }
+    }
+    return t->ok;
+}
+
+bool maze_tiles_close(MazeTiles *t) {
+    if (!t) return false;
+
+    bool ok = t->ok && !atomic_load(&t->failed) && t->next_y == t->height;
+    for (int l = 0; t->levels && l <= t->top; ++l) {
+        free(t->levels[l].pixels);
+    }
+    for (unsigned w = 0; t->images && w < threadpool_size(t->pool); ++w) {
+        bmp_free(t->images[w]);
+    }
+    free(t->levels);
+    free(t->rows);
+    free(t->bits);
+    free(t->north);
+    free(t->images);
+    free(t->paths);
+    free(t->name);
+    free(t);
+    return ok;
+}
+
+bool maze_render_tiles(const Maze *m, const char *name, const MazeRenderConfig *cfg, uint32_t tile_size, ThreadPool *pool) {
+    if (!m || !name) return false;
+
+    MazeRenderConfig defaults;
+    if (!cfg) {
+        maze_render_config_init(&defaults, m);
+        cfg = &defaults;
+    }
+
+    MazeTiles *t = maze_tiles_open(name, m->width, m->height, cfg, m->start, m->end, tile_size, pool);
+    if (!t) return false;
+
+    MazeRow row;
+    for (size_t y = 0; y < m->height; ++y) {
+        maze_get_row(m, y, &row);
+        if (!maze_tiles_row(&row, t)) break;
+    }
+    return maze_tiles_close(t);
+}
@@ -0,0 +1,180 @@
+#include "maze_solver.h"
+
+#include <stdatomic.h> // for atomic_bool
+#include <stdlib.h> // for malloc, calloc, realloc, free
+#include <string.h> // for memcpy
+
+typedef struct Maze Maze;
+typedef struct MazeDistances MazeDistances;
+typedef struct ThreadPool ThreadPool;
+
+#define FRONTIER_CHUNK 1024 // Frontier cells per task
+#define PARALLEL_FRONTIER (4 * FRONTIER_CHUNK) // Smaller frontiers are expanded on the calling thread
+#define FILL_CHUNK ((size_t)1 << 20) // Cells per task of the initial fill
+
+// Growable list of cell indices: a frontier, or one worker's share of the next
+struct CellList {
+    uint32_t *items;
+    size_t size;
+    size_t capacity;
+};
+
+static bool list_reserve(struct CellList *l, size_t n) {
+    if (l->size + n <= l->capacity) return true;
+    size_t capacity = l->capacity ? l->capacity : 1024;
+    while (capacity < l->size + n) capacity *= 2;
+    uint32_t *items = realloc(l->items, capacity * sizeof(uint32_t));
+    if (!items) return false;
+    l->items = items;
+    l->capacity = capacity;
+    return true;
+}
+
+// One BFS level: the cells of `frontier` are at distance level - 1, and every
+// unclaimed neighbor gets distance `level` and joins its worker's next list
+struct DistanceJob {
+    const Maze *m;
+    uint64_t *visited; // Visited bits, in the Maze.visited layout
+    uint32_t *dist;
+    const uint32_t *frontier;
+    size_t frontier_size;
+    uint32_t level;
+    struct CellList *next; // One per worker
+    atomic_bool failed;
+};
+
+// Take an unvisited cell. Shared claims may race with other workers: the
+// plain load skips the atomic for cells already taken, and only the worker
+// whose fetch-or flips the bit wins.
+static inline bool claim(uint64_t *word, uint64_t mask, bool shared) {
+    if (!shared) {
+        if (*word & mask) return false;
+        *word |= mask;
+        return true;
+    }
+    if (__atomic_load_n(word, __ATOMIC_RELAXED) & mask) return false;
+    return !(__atomic_fetch_or(word, mask, __ATOMIC_RELAXED) & mask);
+}
+
+static inline void reach(struct DistanceJob *job, size_t x, size_t y, uint32_t **out, bool shared) {
+    const Maze *m = job->m;
+    if (!claim(job->visited + y * m->row_words + (x >> 6), maze_bit_mask(x), shared)) return;
+    size_t cell = maze_cell_index(m, x, y);
+    job->dist[cell] = job->level;
+    *(*out)++ = (uint32_t)cell;
+}
+
+// Expand frontier cells [i0, i1) into list
+static inline bool expand(struct DistanceJob *job, size_t i0, size_t i1, struct CellList *list, bool shared) {
+    const Maze *m = job->m;
+    if (!list_reserve(list, 4 * (i1 - i0))) return false;
+
+    uint32_t *out = list->items + list->size;
+    for (size_t i = i0; i < i1; ++i) {
+        size_t cell = job->frontier[i];
+        size_t x = cell % m->width, y = cell / m->width;
+        uint64_t bit = maze_bit_mask(x);
+        if (x + 1 < m->width && !(*maze_east_word(m, x, y) & bit)) reach(job, x + 1, y, &out, shared);
+        if (y + 1 < m->height && !(*maze_south_word(m, x, y) & bit)) reach(job, x, y + 1, &out, shared);
+        if (x > 0 && !(*maze_east_word(m, x - 1, y) & maze_bit_mask(x - 1))) reach(job, x - 1, y, &out, shared);
+        if (y > 0 && !(*maze_south_word(m, x, y - 1) & bit)) reach(job, x, y - 1, &out, shared);
+    }
+    list->size = out - list->items;
+    return true;
+}
+
+static void expand_chunk(void *ctx, size_t task, unsigned worker) {
+    struct DistanceJob *job = ctx;
+    size_t i0 = task * FRONTIER_CHUNK;
+    size_t i1 = i0 + FRONTIER_CHUNK < job->frontier_size ? i0 + FRONTIER_CHUNK : job->frontier_size;
+    if (!expand(job, i0, i1, &job->next[worker], true)) {
+        atomic_store(&job->failed, true);
+    }
+}
+
+static void fill_unreachable(void *ctx, size_t task, unsigned worker) {
+    (void)worker;
+    struct DistanceJob *job = ctx;
+    size_t cells = job->m->width * job->m->height;
+    size_t c0 = task * FILL_CHUNK, c1 = c0 + FILL_CHUNK < cells ? c0 + FILL_CHUNK : cells;
+    for (size_t c = c0; c < c1; ++c) {
+        job->dist[c] = MAZE_UNREACHABLE;
+    }
+}
+
+bool maze_distances(const Maze *m, ThreadPool *pool, MazeDistances *out) {
+    if (!m || !m->walls || !out) return false;
+
+    size_t cells = m->width * m->height;
+    unsigned workers = threadpool_size(pool);
+    out->max = 0;
+    out->reached = 0;
+    out->dist = malloc(cells * sizeof(uint32_t));
+
+    struct DistanceJob job;
+    job.m = m;
+    job.dist = out->dist;
+    job.visited = calloc(m->height * m->row_words, sizeof(uint64_t));
+    job.next = calloc(workers, sizeof(struct CellList));
+    atomic_init(&job.failed, false);
+    struct CellList frontier = { NULL, 0, 0 };
+    bool ok = out->dist && job.visited && job.next && list_reserve(&frontier, 1);
+
+    if (ok) {
+        threadpool_run(pool, (cells + FILL_CHUNK - 1) / FILL_CHUNK, fill_unreachable, &job);
+        size_t start = maze_cell_index(m, m->start.x, m->start.y);
+        job.visited[m->start.y * m->row_words + (m->start.x >> 6)] |= maze_bit_mask(m->start.x);
+        job.dist[start] = 0;
+        frontier.items[frontier.size++] = (uint32_t)start;
+    }
+
+    for (uint32_t level = 0; ok && frontier.size > 0; ++level) {
+        out->reached += frontier.size;
+        out->max = level;
+        job.frontier = frontier.items;
+        job.frontier_size = frontier.size;
+        job.level = level + 1;
+
+        if (workers > 1 && frontier.size >= PARALLEL_FRONTIER) {
+            threadpool_run(pool, (frontier.size + FRONTIER_CHUNK - 1) / FRONTIER_CHUNK, expand_chunk, &job);
+            ok = !atomic_load(&job.failed);
+
+            // Gather the workers' finds into the next frontier
+            frontier.size = 0;
+            for (unsigned w = 0; ok && w < workers; ++w) {
+                ok = list_reserve(&frontier, job.next[w].size);
+                if (ok) memcpy(frontier.items + frontier.size, job.next[w].items, job.next[w].size * sizeof(uint32_t));
+                frontier.size += job.next[w].size;
+                job.next[w].size = 0;
+            }
+        } else {
+            // Too few cells to be worth waking the workers for
+            struct CellList *next = &job.next[0];
+            ok = expand(&job, 0, frontier.size, next, false);
+            struct CellList t = frontier;
+            frontier = *next;
+            *next = t;
+            next->size = 0;
+        }
+    }
+
+    for (unsigned w = 0; job.next && w < workers; ++w) {
+        free(job.next[w].items);
+    }
+    free(job.next);
+    free(job.visited);
+    free(frontier.items);
+    if (!ok) {
+        maze_distances_free(out);
+        return false;
+    }
+    return true;
+}
+
+void maze_distances_free(MazeDistances *d) {
+    if (!d) return;
+    free(d->dist);
+    d->dist = NULL;
+    d->max = 0;
+    d->reached = 0;
+}
@@ -0,0 +1,142 @@
+#include "maze_solver.h"
+
+#include <stdlib.h> // for malloc, calloc, realloc, free
+#include <string.h> // for memcpy, memset
+
+typedef struct Maze Maze;
+typedef struct MazeSolution MazeSolution;
+typedef enum Direction Direction;
+
+#define QUEUE_INITIAL 1024 // Starting capacity of the BFS queue, in cells
+
+// FIFO of cell indices in a ring buffer that doubles when full
+struct CellQueue {
+    uint32_t *items;
+    size_t capacity; // A power of two
+    size_t head; // Index of the oldest item
+    size_t size;
+};
+
+static bool queue_push(struct CellQueue *q, uint32_t cell) {
+    if (q->size == q->capacity) {
+        uint32_t *items = realloc(q->items, 2 * q->capacity * sizeof(uint32_t));
+        if (!items) return false;
+        // Unwrap: the items before head move past the old end
+        memcpy(items + q->capacity, items, q->head * sizeof(uint32_t));
+        q->items = items;
+        q->capacity *= 2;
+    }
+    q->items[(q->head + q->size) & (q->capacity - 1)] = cell;
+    q->size++;
+    return true;
+}
+
+static uint32_t queue_pop(struct CellQueue *q) {
+    uint32_t cell = q->items[q->head];
+    q->head = (q->head + 1) & (q->capacity - 1);
+    q->size--;
+    return cell;
+}
+
+// Parent directions: two bits per cell, 32 cells per word
+static inline void set_parent(uint64_t *parent, size_t cell, Direction dir) {
+    parent[cell >> 5] |= (uint64_t)dir << ((cell & 31) * 2);
+}
+
+static inline Direction get_parent(const uint64_t *parent, size_t cell) {
+    return (Direction)((parent[cell >> 5] >> ((cell & 31) * 2)) & 3);
+}
+
+// Word of a visited bitset laid out like Maze.visited
+static inline uint64_t *visited_word(const Maze *m, uint64_t *visited, size_t x, size_t y) {
+    return visited + y * m->row_words + (x >> 6);
+}
+
+// Mark a neighbor reached from the cell on its `back` side; false only if the
+// queue cannot grow
+static inline bool visit(const Maze *m, uint64_t *visited, uint64_t *parent, struct CellQueue *q, size_t x, size_t y, Direction back) {
+    uint64_t *word = visited_word(m, visited, x, y);
+    if (*word & maze_bit_mask(x)) return true;
+    *word |= maze_bit_mask(x);
+    size_t cell = maze_cell_index(m, x, y);
+    set_parent(parent, cell, back);
+    return queue_push(q, (uint32_t)cell);
+}
+
+bool maze_solve(const Maze *m, MazeSolution *out) {
+    if (!m || !m->walls || !out) return false;
+
+    size_t cells = m->width * m->height;
+    out->length = 0;
+    out->explored = 0;
+    out->row_words = m->row_words;
+    out->path = NULL;
+    uint64_t *visited = calloc(m->height * m->row_words, sizeof(uint64_t));
+    uint64_t *parent = calloc((cells + 31) / 32, sizeof(uint64_t));
+    struct CellQueue q = { malloc(QUEUE_INITIAL * sizeof(uint32_t)), QUEUE_INITIAL, 0, 0 };
+    bool ok = visited && parent && q.items;
+
+    size_t start = maze_cell_index(m, m->start.x, m->start.y);
+    size_t end = maze_cell_index(m, m->end.x, m->end.y);
+    bool found = false;
+    if (ok) {
+        *visited_word(m, visited, m->start.x, m->start.y) |= maze_bit_mask(m->start.x);
+        ok = queue_push(&q, (uint32_t)start);
+    }
+
+    while (ok && q.size > 0) {
+        size_t cell = queue_pop(&q);
+        out->explored++;
+        if (cell == end) {
+            found = true;
+            break;
+        }
+        size_t x = cell % m->width, y = cell / m->width;
+        uint64_t bit = maze_bit_mask(x);
+        // Each neighbor records the direction that leads back to this cell.
+        // Border walls are checked too, for grids loaded from damaged files.
+        if (x + 1 < m->width && !(*maze_east_word(m, x, y) & bit)) ok = visit(m, visited, parent, &q, x + 1, y, LEFT);
+        if (ok && y + 1 < m->height && !(*maze_south_word(m, x, y) & bit)) ok = visit(m, visited, parent, &q, x, y + 1, UP);
+        if (ok && x > 0 && !(*maze_east_word(m, x - 1, y) & maze_bit_mask(x - 1))) ok = visit(m, visited, parent, &q, x - 1, y, RIGHT);
+        if (ok && y > 0 && !(*maze_south_word(m, x, y - 1) & bit)) ok = visit(m, visited, parent, &q, x, y - 1, DOWN);
+    }
+
+    // The visited bits are done with and become the path bits, which are
+    // set by walking the parent directions back from end
+    if (ok) {
+        memset(visited, 0, m->height * m->row_words * sizeof(uint64_t));
+        out->path = visited;
+        visited = NULL;
+    }
+    if (ok && found) {
+        size_t x = m->end.x, y = m->end.y;
+        for (;;) {
+            out->path[y * m->row_words + (x >> 6)] |= maze_bit_mask(x);
+            out->length++;
+            size_t cell = maze_cell_index(m, x, y);
+            if (cell == start) break;
+            switch (get_parent(parent, cell)) {
+                case UP:    y--; break;
+                case RIGHT: x++; break;
+                case DOWN:  y++; break;
+                case LEFT:  x--; break;
+            }
+        }
+    }
+
+    free(q.items);
+    free(parent);
+    free(visited);
+    if (!ok) {
+        maze_solution_free(out);
+        return false;
+    }
+    return true;
+}
+
+void maze_solution_free(MazeSolution *s) {
+    if (!s) return;
+    free(s->path);
+    s->path = NULL;
+    s->length = 0;
+}
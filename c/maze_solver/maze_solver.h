@@ -0,0 +1,49 @@
+#ifndef MAZE_SOLVER_H
+#define MAZE_SOLVER_H
+
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+
+#include "../maze_generator/maze_generator.h"
+#include "../threadpool/threadpool.h"
+
+// Breadth-first search from start to end. Besides the maze itself it needs
+// three bits per cell: one visited bit, which is reused for the returned path,
+// and two bits naming the direction back to the parent of each reached cell.
+// The queue of 32-bit cell indices only ever holds the search frontier, which
+// in a perfect maze is far smaller than the grid.
+
+struct MazeSolution {
+    size_t length; // Cells on the path, start and end included; 0 if end is unreachable
+    size_t explored; // Cells reached before the search got to end
+    size_t row_words; // 64-bit words per bit row of path
+    uint64_t *path; // Path bits, row_words words per cell row (the visited-bit layout)
+};
+
+bool maze_solve(const struct Maze *m, struct MazeSolution *out); // Find a shortest path from m->start to m->end; false if out of memory
+
+void maze_solution_free(struct MazeSolution *s); // Free the path bits of a solution
+
+static inline bool maze_on_path(const struct MazeSolution *s, size_t x, size_t y) { return (s->path[y * s->row_words + (x >> 6)] >> (x & 63)) & 1; } // Check whether cell (x, y) is on the path
+
+// Distance field
+// --------------
+// A level-synchronous BFS from start over the whole maze. Each level's
+// frontier is split into chunks that the pool's workers expand, claiming
+// cells with an atomic fetch-or on a shared visited bitset, so every cell is
+// reached once and gets the distance of its level. Narrow frontiers, which
+// long corridors produce, are expanded on the calling thread instead.
+#define MAZE_UNREACHABLE UINT32_MAX // Distance of a cell not connected to start
+
+struct MazeDistances {
+    uint32_t *dist; // Steps from start for every cell index, MAZE_UNREACHABLE if not reached
+    uint32_t max; // Largest distance
+    size_t reached; // Cells connected to start
+};
+
+bool maze_distances(const struct Maze *m, struct ThreadPool *pool, struct MazeDistances *out); // Distance from m->start to every cell on the pool's workers (NULL = one thread); false if out of memory
+
+void maze_distances_free(struct MazeDistances *d); // Free the distance array
+
+#endif // MAZE_SOLVER_H
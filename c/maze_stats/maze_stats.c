@@ -0,0 +1,85 @@
+#include "maze_stats.h"
+
+#include <stdio.h>  // for FILE, fopen, fgets, sscanf
+#include <string.h> // for memset
+
+typedef struct MazeStats MazeStats;
+
+#ifdef MAZE_STATS
+_Thread_local MazeStats maze_stats_local;
+#endif
+
+static MazeStats totals; // Flushed counters of every thread, updated atomically
+static uint64_t syscalls_at_reset; // The process's write() count at the last reset
+
+// write() calls made by the process so far, from /proc/self/io; 0 where that
+// is not available
+static uint64_t write_syscalls(void) {
+    FILE *fp = fopen("/proc/self/io", "r");
+    if (!fp) return 0;
+    char line[128];
+    unsigned long long n = 0;
+    while (fgets(line, sizeof line, fp)) {
+        if (sscanf(line, "syscw: %llu", &n) == 1) break;
+    }
+    fclose(fp);
+    return n;
+}
+
+bool maze_stats_enabled(void) {
+#ifdef MAZE_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void maze_stats_reset(void) {
+#ifdef MAZE_STATS
+    memset(&maze_stats_local, 0, sizeof maze_stats_local);
+#endif
+    memset(&totals, 0, sizeof totals);
+    syscalls_at_reset = write_syscalls();
+}
+
+void maze_stats_flush(void) {
+#ifdef MAZE_STATS
+    MazeStats *s = &maze_stats_local;
+    __atomic_fetch_add(&totals.stack_pushes, s->stack_pushes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&totals.stack_pops, s->stack_pops, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&totals.backtracks, s->backtracks, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&totals.rng_draws, s->rng_draws, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&totals.visited_probes, s->visited_probes, __ATOMIC_RELAXED);
+    for (int c = 0; c < MAZE_STATS_COLORS; ++c) {
+        __atomic_fetch_add(&totals.pixels[c], s->pixels[c], __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&totals.bytes_written, s->bytes_written, __ATOMIC_RELAXED);
+
+    uint64_t depth = __atomic_load_n(&totals.stack_max_depth, __ATOMIC_RELAXED);
+    while (s->stack_max_depth > depth &&
+           !__atomic_compare_exchange_n(&totals.stack_max_depth, &depth, s->stack_max_depth, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    memset(s, 0, sizeof *s);
+#endif
+}
+
+void maze_stats_collect(MazeStats *out) {
+    if (!out) return;
+
+    maze_stats_flush();
+    // Callers collect with no job running, so the totals are settled
+    *out = totals;
+    out->write_syscalls = write_syscalls() - syscalls_at_reset;
+}
+
+const char *maze_stats_color_name(enum MazeStatsColor color) {
+    switch (color) {
+        case MAZE_STATS_BG:     return "bg";
+        case MAZE_STATS_WALL:   return "wall";
+        case MAZE_STATS_MARKER: return "marker";
+        case MAZE_STATS_PATH:   return "path";
+        case MAZE_STATS_HEAT:   return "heat";
+        default:                return "unknown";
+    }
+}
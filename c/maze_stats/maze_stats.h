@@ -0,0 +1,56 @@
+#ifndef MAZE_STATS_H
+#define MAZE_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hot-path counters, compiled in only when MAZE_STATS is defined (-DMAZE_STATS).
+// Without it every MAZE_STAT_* macro expands to nothing and the counters stay
+// zero. Each thread counts into its own thread-local block. A pool worker adds
+// its block to the process totals when it finishes a job, and the caller's
+// block is added by maze_stats_collect, so counting never touches shared
+// memory.
+
+// What a pixel was written as
+enum MazeStatsColor {
+    MAZE_STATS_BG,
+    MAZE_STATS_WALL,
+    MAZE_STATS_MARKER, // Start and end cells
+    MAZE_STATS_PATH,
+    MAZE_STATS_HEAT,
+    MAZE_STATS_COLORS // Number of colors counted
+};
+
+struct MazeStats {
+    uint64_t stack_pushes;
+    uint64_t stack_pops;
+    uint64_t stack_max_depth; // Deepest any stack got
+    uint64_t backtracks; // DFS steps back from a cell with no unvisited neighbor
+    uint64_t rng_draws; // 64-bit words drawn from any Rng
+    uint64_t visited_probes; // Neighbor probes that found the cell already visited
+    uint64_t pixels[MAZE_STATS_COLORS]; // Pixels written, per color; overdrawn pixels count again
+    uint64_t bytes_written; // Bytes written to output files
+    uint64_t write_syscalls; // write() calls made by the whole process (Linux only, else 0)
+};
+
+#ifdef MAZE_STATS
+extern _Thread_local struct MazeStats maze_stats_local; // The calling thread's counters
+
+#define MAZE_STAT_ADD(field, n) (maze_stats_local.field += (n)) // Count n events of the calling thread
+#define MAZE_STAT_MAX(field, v) do { if ((uint64_t)(v) > maze_stats_local.field) maze_stats_local.field = (v); } while (0) // Raise a high-water mark of the calling thread
+#else
+#define MAZE_STAT_ADD(field, n) ((void)0)
+#define MAZE_STAT_MAX(field, v) ((void)0)
+#endif
+
+bool maze_stats_enabled(void); // Whether the counters were compiled in
+
+void maze_stats_reset(void); // Zero the totals and the calling thread's counters; call with no pool job running
+
+void maze_stats_flush(void); // Add the calling thread's counters to the totals and zero them
+
+void maze_stats_collect(struct MazeStats *out); // Flush the calling thread and copy the totals since the last reset
+
+const char *maze_stats_color_name(enum MazeStatsColor color); // Short name of a color ("bg", "wall", "marker", "path", "heat")
+
+#endif // MAZE_STATS_H
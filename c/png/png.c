@@ -0,0 +1,423 @@
+#include "png.h"
+#include "../maze_stats/maze_stats.h"
+
+#include <pthread.h> // for pthread_once
+#include <stdio.h>  // for FILE, fopen, fwrite
+#include <stdlib.h> // for malloc, realloc, calloc, free
+#include <string.h> // for memcpy, memset
+
+typedef struct BmpImage BmpImage;
+typedef struct ThreadPool ThreadPool;
+
+#define BAND_BYTES (1u << 20) // Filtered bytes per band, roughly
+#define HASH_BITS 15
+#define NO_POS UINT32_MAX // Empty hash slot
+#define WINDOW 32768 // Deflate's largest match distance
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define ADLER_BASE 65521
+
+// Output bits of a deflate stream, least significant bit first
+struct BitWriter {
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    uint64_t acc; // Pending bits
+    int n; // Number of pending bits, < 32 between calls
+    bool ok; // No allocation has failed so far
+};
+
+// One band of rows, compressed by one task
+struct PngBand {
+    uint8_t *data; // Deflate blocks of the band, ending on a byte boundary
+    size_t len;
+    uint32_t adler; // Adler-32 of the band's filtered bytes
+    size_t raw_len; // Filtered bytes in the band
+    uint32_t crc; // CRC-32 of the band's IDAT chunk (type and data)
+    bool ok;
+};
+
+struct PngJob {
+    const BmpImage *image;
+    size_t row_bytes; // Pixel bytes per row, without the filter byte
+    size_t band_rows;
+    size_t height;
+    struct PngBand *bands;
+    uint8_t **filtered; // Per worker: filtered rows of the current band
+    uint32_t **heads; // Per worker: match hash table
+};
+
+static uint32_t crc_table[256];
+static uint16_t lit_code[288]; // Fixed Huffman codes, bit-reversed for LSB-first output
+static uint8_t lit_bits[288];
+static uint8_t dist_code[30];
+static uint16_t len_symbol[MAX_MATCH + 1]; // Match length -> index into LEN_BASE
+
+static const uint16_t LEN_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LEN_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static uint32_t reverse_bits(uint32_t code, int bits) {
+    uint32_t r = 0;
+    for (int i = 0; i < bits; ++i) {
+        r = (r << 1) | ((code >> i) & 1);
+    }
+    return r;
+}
+
+// Build the CRC and fixed Huffman tables; run once through tables_once, as
+// png_save may be called from several threads at a time
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void init_tables(void) {
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) {
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+
+    for (int s = 0; s < 288; ++s) {
+        uint32_t code;
+        int bits;
+        if (s < 144) { code = 0x30 + s; bits = 8; }
+        else if (s < 256) { code = 0x190 + (s - 144); bits = 9; }
+        else if (s < 280) { code = s - 256; bits = 7; }
+        else { code = 0xC0 + (s - 280); bits = 8; }
+        lit_code[s] = (uint16_t)reverse_bits(code, bits);
+        lit_bits[s] = (uint8_t)bits;
+    }
+    for (int d = 0; d < 30; ++d) {
+        dist_code[d] = (uint8_t)reverse_bits(d, 5);
+    }
+    for (int sym = 0, len = MIN_MATCH; len <= MAX_MATCH; ++len) {
+        while (sym < 28 && len >= LEN_BASE[sym + 1]) sym++;
+        len_symbol[len] = (uint16_t)sym;
+    }
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t adler32_update(uint32_t adler, const uint8_t *data, size_t len) {
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (len > 0) {
+        size_t n = len < 5552 ? len : 5552; // Largest n with no 32-bit overflow
+        len -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+    }
+    return a | (b << 16);
+}
+
+// Adler-32 of A followed by B, from the checksums of A and B and B's length
+static uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t len2) {
+    uint32_t rem = (uint32_t)(len2 % ADLER_BASE);
+    uint32_t sum1 = adler1 & 0xFFFF;
+    uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % ADLER_BASE);
+    sum1 += (adler2 & 0xFFFF) + ADLER_BASE - 1;
+    sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum2 >= 2u * ADLER_BASE) sum2 -= 2u * ADLER_BASE;
+    if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+    return sum1 | (sum2 << 16);
+}
+
+static void put_byte(struct BitWriter *bw, uint8_t byte) {
+    if (!bw->ok) return;
+    if (bw->len == bw->cap) {
+        size_t cap = bw->cap ? bw->cap * 2 : 4096;
+        uint8_t *buf = realloc(bw->buf, cap);
+        if (!buf) {
+            bw->ok = false;
+            return;
+        }
+        bw->buf = buf;
+        bw->cap = cap;
+    }
+    bw->buf[bw->len++] = byte;
+}
+
+static void put_bits(struct BitWriter *bw, uint32_t bits, int count) {
+    bw->acc |= (uint64_t)bits << bw->n;
+    bw->n += count;
+    if (bw->n < 32) return;
+
+    for (int i = 0; i < 4; ++i) {
+        put_byte(bw, (uint8_t)(bw->acc >> (8 * i)));
+    }
+    bw->acc >>= 32;
+    bw->n -= 32;
+}
+
+// Pad to a byte boundary and move every pending byte to the buffer
+static void flush_bits(struct BitWriter *bw) {
+    if (bw->n & 7) put_bits(bw, 0, 8 - (bw->n & 7));
+    for (; bw->n > 0; bw->n -= 8) {
+        put_byte(bw, (uint8_t)bw->acc);
+        bw->acc >>= 8;
+    }
+}
+
+static inline void put_literal(struct BitWriter *bw, uint8_t byte) {
+    put_bits(bw, lit_code[byte], lit_bits[byte]);
+}
+
+static inline void put_match(struct BitWriter *bw, size_t len, size_t dist) {
+    int ls = len_symbol[len];
+    uint32_t bits = lit_code[257 + ls];
+    int n = lit_bits[257 + ls];
+    bits |= (uint32_t)(len - LEN_BASE[ls]) << n;
+    n += LEN_EXTRA[ls];
+
+    // Distance code: two codes per power of two past 4
+    int dc;
+    if (dist <= 2) {
+        dc = (int)dist - 1;
+    } else {
+        uint32_t x = (uint32_t)dist - 1;
+        int log = 31 - __builtin_clz(x);
+        dc = 2 * log + ((x >> (log - 1)) & 1);
+    }
+    put_bits(bw, bits, n);
+    put_bits(bw, dist_code[dc] | (uint32_t)(dist - DIST_BASE[dc]) << 5, 5 + DIST_EXTRA[dc]);
+}
+
+// Bytes that a and b have in common, up to max
+static inline size_t match_length(const uint8_t *a, const uint8_t *b, size_t max) {
+    size_t len = 0;
+    while (len + 8 <= max) {
+        uint64_t x, y;
+        memcpy(&x, a + len, sizeof(x));
+        memcpy(&y, b + len, sizeof(y));
+        if (x != y) return len + (__builtin_ctzll(x ^ y) >> 3);
+        len += 8;
+    }
+    while (len < max && a[len] == b[len]) len++;
+    return len;
+}
+
+// Compress n bytes as one fixed-Huffman block, then a sync flush (an empty
+// stored block) so the output ends on a byte boundary. Matches never reach
+// before src, so every band compresses on its own.
+static void deflate_band(struct BitWriter *bw, const uint8_t *src, size_t n, uint32_t *head) {
+    memset(head, 0xFF, ((size_t)1 << HASH_BITS) * sizeof(uint32_t));
+    put_bits(bw, 1 << 1, 3); // BFINAL = 0, BTYPE = 01 (fixed Huffman)
+
+    size_t pos = 0;
+    while (pos < n) {
+        size_t max = n - pos < MAX_MATCH ? n - pos : MAX_MATCH;
+        size_t best = 0, dist = 0;
+
+        // A run of the previous byte: most of an Up-filtered maze
+        if (pos > 0) {
+            best = match_length(src + pos, src + pos - 1, max);
+            dist = 1;
+        }
+        if (best < max && n - pos >= 4) {
+            uint32_t v;
+            memcpy(&v, src + pos, sizeof(v));
+            uint32_t h = (v * 2654435761u) >> (32 - HASH_BITS);
+            uint32_t cand = head[h];
+            head[h] = (uint32_t)pos;
+            if (cand != NO_POS && pos - cand <= WINDOW && pos - cand > 1) {
+                size_t len = match_length(src + pos, src + cand, max);
+                if (len > best) {
+                    best = len;
+                    dist = pos - cand;
+                }
+            }
+        }
+
+        if (best >= MIN_MATCH) {
+            put_match(bw, best, dist);
+            pos += best;
+        } else {
+            put_literal(bw, src[pos]);
+            pos++;
+        }
+    }
+
+    put_bits(bw, lit_code[256], lit_bits[256]); // End of block
+    put_bits(bw, 0, 3); // BFINAL = 0, BTYPE = 00 (stored)
+    flush_bits(bw);
+    put_bits(bw, 0xFFFF0000u, 32); // LEN = 0, NLEN = 0xFFFF
+}
+
+// Write one filtered row: the Up filter byte, then each byte minus the one
+// above it. PNG stores RGB where the BMP has BGR.
+static void filter_row(uint8_t *out, const uint8_t *row, const uint8_t *above, size_t row_bytes, bool bgr) {
+    *out++ = 2; // Up
+    if (bgr) {
+        for (size_t i = 0; i < row_bytes; i += 3) {
+            out[i] = row[i + 2] - (above ? above[i + 2] : 0);
+            out[i + 1] = row[i + 1] - (above ? above[i + 1] : 0);
+            out[i + 2] = row[i] - (above ? above[i] : 0);
+        }
+    } else {
+        for (size_t i = 0; i < row_bytes; ++i) {
+            out[i] = row[i] - (above ? above[i] : 0);
+        }
+    }
+}
+
+static void compress_band(void *ctx, size_t task, unsigned worker) {
+    struct PngJob *job = ctx;
+    struct PngBand *band = &job->bands[task];
+    const BmpImage *image = job->image;
+    size_t y0 = task * job->band_rows;
+    size_t y1 = y0 + job->band_rows < job->height ? y0 + job->band_rows : job->height;
+    bool bgr = image->infoHeader.biBitCount == 24;
+
+    uint8_t *filtered = job->filtered[worker];
+    for (size_t y = y0; y < y1; ++y) {
+        const uint8_t *row = (const uint8_t *)bmp_row(image, (int)y);
+        const uint8_t *above = y > 0 ? (const uint8_t *)bmp_row(image, (int)y - 1) : NULL;
+        filter_row(filtered + (y - y0) * (job->row_bytes + 1), row, above, job->row_bytes, bgr);
+    }
+    band->raw_len = (y1 - y0) * (job->row_bytes + 1);
+    band->adler = adler32_update(1, filtered, band->raw_len);
+
+    // The chunk type leads the data, so the CRC can cover both in one pass
+    struct BitWriter bw = { NULL, 0, 0, 0, 0, true };
+    put_bits(&bw, 'I' | 'D' << 8 | 'A' << 16 | (uint32_t)'T' << 24, 32);
+    if (task == 0) {
+        put_bits(&bw, 0x78 | 0x01 << 8, 16); // zlib header: deflate, 32K window, no dictionary
+    }
+    deflate_band(&bw, filtered, band->raw_len, job->heads[worker]);
+
+    band->ok = bw.ok;
+    band->data = bw.buf;
+    band->len = bw.len;
+    if (band->ok) band->crc = crc32_update(0, band->data, band->len);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Write a chunk whose type and data are contiguous in `typed` (4 + len bytes)
+static bool write_chunk(FILE *fp, const uint8_t *typed, size_t len, uint32_t crc) {
+    uint8_t len_be[4], crc_be[4];
+    put_u32(len_be, (uint32_t)len);
+    put_u32(crc_be, crc);
+    MAZE_STAT_ADD(bytes_written, 12 + len);
+    return fwrite(len_be, 1, 4, fp) == 4 &&
+           fwrite(typed, 1, 4 + len, fp) == 4 + len &&
+           fwrite(crc_be, 1, 4, fp) == 4;
+}
+
+bool png_save(const char *filename, const BmpImage *image, ThreadPool *pool) {
+    if (!filename || !image) return false;
+
+    int bit_count = image->infoHeader.biBitCount;
+    if (bit_count != 1 && bit_count != 8 && bit_count != 24) return false;
+    pthread_once(&tables_once, init_tables);
+
+    size_t width = image->infoHeader.biWidth;
+    size_t height = abs(image->infoHeader.biHeight);
+    size_t row_bytes = (width * bit_count + 7) / 8;
+    size_t band_rows = BAND_BYTES / (row_bytes + 1) ? BAND_BYTES / (row_bytes + 1) : 1;
+    size_t n_bands = (height + band_rows - 1) / band_rows;
+    unsigned workers = threadpool_size(pool);
+
+    struct PngJob job = { image, row_bytes, band_rows, height, NULL, NULL, NULL };
+    job.bands = calloc(n_bands, sizeof(struct PngBand));
+    job.filtered = calloc(workers, sizeof(uint8_t *));
+    job.heads = calloc(workers, sizeof(uint32_t *));
+    bool ok = job.bands && job.filtered && job.heads;
+    for (unsigned w = 0; ok && w < workers; ++w) {
+        job.filtered[w] = malloc(band_rows * (row_bytes + 1));
+        job.heads[w] = malloc(((size_t)1 << HASH_BITS) * sizeof(uint32_t));
+        ok = job.filtered[w] && job.heads[w];
+    }
+
+    // 1) Filter and compress every band in parallel
+    if (ok) threadpool_run(pool, n_bands, compress_band, &job);
+    for (size_t b = 0; ok && b < n_bands; ++b) {
+        ok = job.bands[b].ok;
+    }
+
+    // 2) Signature, header and palette, then one IDAT chunk per band
+    FILE *fp = ok ? fopen(filename, "wb") : NULL;
+    ok = fp != NULL;
+    if (ok) {
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        uint8_t ihdr[4 + 13] = { 'I', 'H', 'D', 'R' };
+        put_u32(ihdr + 4, (uint32_t)width);
+        put_u32(ihdr + 8, (uint32_t)height);
+        ihdr[12] = bit_count == 1 ? 1 : 8; // Bit depth
+        ihdr[13] = bit_count == 24 ? 2 : 3; // Color type: RGB or palette
+        ihdr[14] = ihdr[15] = ihdr[16] = 0; // Deflate, adaptive filtering, no interlace
+        MAZE_STAT_ADD(bytes_written, sizeof(signature));
+        ok = fwrite(signature, 1, sizeof(signature), fp) == sizeof(signature) &&
+             write_chunk(fp, ihdr, 13, crc32_update(0, ihdr, sizeof(ihdr)));
+
+        if (ok && bit_count != 24) {
+            int n_colors = image->infoHeader.biClrUsed ? (int)image->infoHeader.biClrUsed : 1 << bit_count;
+            uint8_t plte[4 + 3 * 256] = { 'P', 'L', 'T', 'E' };
+            for (int i = 0; i < n_colors; ++i) {
+                plte[4 + 3 * i] = image->palette[i].rgbRed;
+                plte[5 + 3 * i] = image->palette[i].rgbGreen;
+                plte[6 + 3 * i] = image->palette[i].rgbBlue;
+            }
+            ok = write_chunk(fp, plte, 3 * n_colors, crc32_update(0, plte, 4 + 3 * n_colors));
+        }
+    }
+
+    uint32_t adler = 1;
+    for (size_t b = 0; ok && b < n_bands; ++b) {
+        struct PngBand *band = &job.bands[b];
+        ok = write_chunk(fp, band->data, band->len - 4, band->crc);
+        adler = adler32_combine(adler, band->adler, band->raw_len);
+    }
+
+    // 3) The final (empty) block and the checksum of all bands close the stream
+    if (ok) {
+        uint8_t tail[4 + 6] = { 'I', 'D', 'A', 'T', 0x03, 0x00 };
+        uint8_t iend[4] = { 'I', 'E', 'N', 'D' };
+        put_u32(tail + 6, adler);
+        ok = write_chunk(fp, tail, 6, crc32_update(0, tail, sizeof(tail))) &&
+             write_chunk(fp, iend, 0, crc32_update(0, iend, sizeof(iend)));
+    }
+    if (fp && fclose(fp) != 0) ok = false;
+
+    for (size_t b = 0; job.bands && b < n_bands; ++b) {
+        free(job.bands[b].data);
+    }
+    for (unsigned w = 0; w < workers; ++w) {
+        if (job.filtered) free(job.filtered[w]);
+        if (job.heads) free(job.heads[w]);
+    }
+    free(job.bands);
+    free(job.filtered);
+    free(job.heads);
+    return ok;
+}
@@ -0,0 +1,17 @@
+#ifndef PNG_H
+#define PNG_H
+
+#include <stdbool.h>
+
+#include "../bmp/bmp.h"
+#include "../threadpool/threadpool.h"
+
+// Self-contained PNG encoder. Rows are Up-filtered and split into bands that
+// are deflated on separate threads, each ending on a byte boundary with a
+// sync flush, so the bands concatenate into one zlib stream (as pigz does).
+// Maze images are mostly long runs, which the matcher finds as distance-1
+// copies.
+
+bool png_save(const char *filename, const struct BmpImage *image, struct ThreadPool *pool); // Save a 1-, 8- or 24-bit image as PNG (NULL pool: one thread)
+
+#endif // PNG_H
@@ -0,0 +1,23 @@
+#include "rng.h"
+
+typedef struct Rng Rng;
+
+// SplitMix64 step, used to spread a seed over the whole state
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(Rng *rng, uint64_t seed) {
+    for (int i = 0; i < 4; ++i) {
+        rng->s[i] = splitmix64(&seed); // SplitMix64 never yields an all-zero state
+    }
+}
+
+void rng_seed_stream(Rng *rng, uint64_t seed, uint64_t stream) {
+    // Hash the stream number first: seeds that differ by the SplitMix64
+    // increment would otherwise give overlapping sequences
+    rng_seed(rng, seed ^ splitmix64(&stream));
+}
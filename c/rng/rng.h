@@ -0,0 +1,46 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+#include "../maze_stats/maze_stats.h"
+
+// xoshiro256** pseudo-random generator. All state lives in the struct, so
+// every generator context owns an independent stream and the same seed gives
+// the same sequence on every platform.
+struct Rng {
+    uint64_t s[4]; // Generator state, never all zero
+};
+
+void rng_seed(struct Rng *rng, uint64_t seed); // Initialize the state from a 64-bit seed (expanded with SplitMix64)
+
+void rng_seed_stream(struct Rng *rng, uint64_t seed, uint64_t stream); // Initialize an independent stream for e.g. one tile or row, derived from a seed and a stream number
+
+static inline uint64_t rng_rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+static inline uint64_t rng_next(struct Rng *rng) { // Next 64 random bits
+    MAZE_STAT_ADD(rng_draws, 1);
+    uint64_t *s = rng->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return result;
+}
+
+static inline uint32_t rng_bounded(struct Rng *rng, uint32_t n) { // Uniform value in [0, n) without modulo bias (Lemire's method), n > 0
+    uint64_t m = (rng_next(rng) >> 32) * n;
+    if ((uint32_t)m < n) {
+        uint32_t threshold = -n % n; // 2^32 mod n
+        while ((uint32_t)m < threshold) {
+            m = (rng_next(rng) >> 32) * n;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+#endif // RNG_H
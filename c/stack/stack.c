@@ -1,4 +1,5 @@
 #include "stack.h"
+#include "../maze_stats/maze_stats.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,77 +8,86 @@
 
 typedef struct Stack Stack;
 
+#define STACK_INITIAL_ALLOCATION 1024 // Items allocated on the first push
+
 Stack *createStack(int32_t capacity) {
     Stack *stack = (Stack *)malloc(sizeof(Stack));
     if (!stack) {
         return NULL;
     }
 
-    stack->top = NULL;
+    stack->items = NULL;
     stack->size = 0;
+    stack->allocated = 0;
     stack->capacity = capacity;
 
     return stack;
 }
 
-void freeStack(Stack *stack, void (*freeData)(void*)) {
+void freeStack(Stack *stack) {
     if (!stack) {
         return;
     }
 
-    struct stackNode *current = stack->top;
-    struct stackNode *next;
-
-    while (current) {
-        next = current->next;
-        if (freeData) {
-            freeData(current->data);
-        }
-        free(current);
-        current = next;
-    }
-
+    free(stack->items);
     free(stack);
 }
 
-bool push(Stack *stack, void *data) {
-    if (stack->capacity != -1 && stack->size >= stack->capacity) {
+void clearStack(Stack *stack) {
+    stack->size = 0;
+}
+
+// Double the storage (bounded by the capacity) so pushes stay amortized O(1)
+static bool growStack(Stack *stack) {
+    uint64_t allocated = stack->allocated ? (uint64_t)stack->allocated * 2 : STACK_INITIAL_ALLOCATION;
+    if (stack->capacity >= 0 && allocated > (uint64_t)stack->capacity) {
+        allocated = stack->capacity;
+    }
+    if (allocated > UINT32_MAX) {
+        allocated = UINT32_MAX;
+    }
+    if (allocated <= stack->size) {
         return false;
     }
 
-    struct stackNode *newNode = (struct stackNode *)malloc(sizeof(struct stackNode));
-    if (!newNode) {
+    uint32_t *items = (uint32_t *)realloc(stack->items, allocated * sizeof(uint32_t));
+    if (!items) {
         return false;
     }
 
-    newNode->data = data;
-    newNode->next = stack->top;
-    stack->top = newNode;
-    stack->size++;
-
+    stack->items = items;
+    stack->allocated = (uint32_t)allocated;
     return true;
 }
 
-void *pop(Stack *stack) {
-    if (stack->size == 0) {
-        return NULL;
+bool push(Stack *stack, uint32_t item) {
+    if (stack->capacity >= 0 && stack->size >= (uint32_t)stack->capacity) {
+        return false;
     }
 
-    struct stackNode *topNode = stack->top;
-    void *data = topNode->data;
+    if (stack->size == stack->allocated && !growStack(stack)) {
+        return false;
+    }
 
-    stack->top = topNode->next;
-    free(topNode);
-    stack->size--;
+    stack->items[stack->size++] = item;
+    MAZE_STAT_ADD(stack_pushes, 1);
+    MAZE_STAT_MAX(stack_max_depth, stack->size);
+    return true;
+}
 
-    return data;
+uint32_t pop(Stack *stack) {
+    if (stack->size == 0) {
+        return 0;
+    }
+    MAZE_STAT_ADD(stack_pops, 1);
+    return stack->items[--stack->size];
 }
 
-void *peek(Stack *stack) {
+uint32_t peek(Stack *stack) {
     if (stack->size == 0) {
-        return NULL;
+        return 0;
     }
-    return stack->top->data;
+    return stack->items[stack->size - 1];
 }
 
 bool isEmpty(Stack *stack) {
@@ -4,29 +4,26 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-struct stackNode {
-	void *data; // void Pointer to the data
-	struct stackNode *next; // Pointer to the next node
-};
-
-
 struct Stack {
-	struct stackNode *top; // Pointer to the top node
+	uint32_t *items;	   // Contiguous item storage, bottom of the stack first
 	uint32_t size;		   // Size of the stack
+	uint32_t allocated;	   // Number of items the storage can hold before it grows
 	int32_t capacity;	   // Maximum capacity of the stack. negative if no limit
 };
 
 
 struct Stack *createStack(int32_t capacity); // Create a stack with a given capacity
 
-void freeStack(struct Stack *stack, void (*freeData)(void*)); // Destroy the stack and free memory
+void freeStack(struct Stack *stack); // Destroy the stack and free memory
+
+void clearStack(struct Stack *stack); // Remove all items but keep the storage for reuse
 
-bool push(struct Stack *stack, void *data); // Push data onto the stack
+bool push(struct Stack *stack, uint32_t item); // Push an item onto the stack, growing the storage geometrically
 
-void *pop(struct Stack *stack); // Pop data from the stack
+uint32_t pop(struct Stack *stack); // Pop an item from the stack (0 if empty)
 
-void *peek(struct Stack *stack); // Peek at the top data without removing it
+uint32_t peek(struct Stack *stack); // Peek at the top item without removing it (0 if empty)
 
 bool isEmpty(struct Stack *stack); // Check if the stack is empty
 
-#endif // !STACK_H
\ No newline at end of file
+#endif // !STACK_H
@@ -0,0 +1,268 @@
+#include "threadpool.h"
+#include "../maze_stats/maze_stats.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef struct ThreadPool ThreadPool;
+
+// The tasks [begin, end) a worker still owns in a stealing job, packed in one
+// word so the owner and thieves both update it with a single compare-and-swap.
+// Each range sits on its own cache line.
+struct TaskRange {
+    atomic_uint_least64_t bounds; // begin in the low 32 bits, end in the high 32
+    char pad[64 - sizeof(atomic_uint_least64_t)];
+};
+
+struct ThreadPool {
+    unsigned size; // Workers including the calling thread
+    pthread_t *threads; // size - 1 background workers
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready; // Signalled when a new job is published
+    pthread_cond_t work_done; // Signalled when the last worker leaves a job
+    unsigned long generation; // Incremented for every job
+    unsigned busy; // Background workers still inside the current job
+    bool stopping;
+
+    // Current job
+    ThreadPoolTask fn;
+    void *ctx;
+    size_t n_tasks;
+    atomic_size_t next_task; // Next task index to hand out
+    bool stealing; // Tasks come from per-worker ranges instead of next_task
+    struct TaskRange *ranges; // One per worker
+};
+
+struct WorkerArg {
+    ThreadPool *pool;
+    unsigned worker;
+};
+
+// Take tasks off the shared counter until there are none left
+static void drain(ThreadPool *pool, unsigned worker) {
+    size_t task;
+    while ((task = atomic_fetch_add_explicit(&pool->next_task, 1, memory_order_relaxed)) < pool->n_tasks) {
+        pool->fn(pool->ctx, task, worker);
+    }
+}
+
+static inline uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return (uint64_t)end << 32 | begin;
+}
+
+// Take the first task of a range
+static bool take_first(struct TaskRange *r, size_t *task) {
+    uint64_t v = atomic_load_explicit(&r->bounds, memory_order_relaxed);
+    for (;;) {
+        uint32_t begin = (uint32_t)v, end = (uint32_t)(v >> 32);
+        if (begin >= end) return false;
+        if (atomic_compare_exchange_weak_explicit(&r->bounds, &v, pack_range(begin + 1, end),
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            *task = begin;
+            return true;
+        }
+    }
+}
+
+// Move the back half of the first non-empty range after the thief's into the
+// thief's own, which is empty; false once every range is
+static bool steal(ThreadPool *pool, unsigned thief) {
+    for (unsigned i = 1; i < pool->size; ++i) {
+        struct TaskRange *victim = &pool->ranges[(thief + i) % pool->size];
+        uint64_t v = atomic_load_explicit(&victim->bounds, memory_order_relaxed);
+        for (;;) {
+            uint32_t begin = (uint32_t)v, end = (uint32_t)(v >> 32);
+            if (begin >= end) break;
+            uint32_t mid = begin + (end - begin) / 2;
+            if (atomic_compare_exchange_weak_explicit(&victim->bounds, &v, pack_range(begin, mid),
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                atomic_store_explicit(&pool->ranges[thief].bounds, pack_range(mid, end), memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Work through the worker's own range, then keep stealing until no worker
+// has tasks left
+static void drain_stealing(ThreadPool *pool, unsigned worker) {
+    size_t task;
+    do {
+        while (take_first(&pool->ranges[worker], &task)) {
+            pool->fn(pool->ctx, task, worker);
+        }
+    } while (steal(pool, worker));
+}
+
+static void *worker_main(void *arg) {
+    struct WorkerArg *wa = arg;
+    ThreadPool *pool = wa->pool;
+    unsigned worker = wa->worker;
+    free(wa);
+
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stopping && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->stopping) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (pool->stealing) {
+            drain_stealing(pool, worker);
+        } else {
+            drain(pool, worker);
+        }
+        maze_stats_flush(); // Before the job ends, so the caller's collect sees it
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+unsigned threadpool_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    long n = (long)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n > 0 ? (unsigned)n : 1;
+}
+
+ThreadPool *threadpool_create(unsigned threads) {
+    if (threads == 0) {
+        threads = threadpool_cpu_count();
+    }
+
+    ThreadPool *pool = malloc(sizeof(ThreadPool));
+    if (!pool) return NULL;
+
+    pool->size = 1;
+    pool->threads = malloc(threads * sizeof(pthread_t));
+    pool->ranges = malloc(threads * sizeof(struct TaskRange));
+    pool->generation = 0;
+    pool->busy = 0;
+    pool->stopping = false;
+    pool->fn = NULL;
+    pool->ctx = NULL;
+    pool->n_tasks = 0;
+    atomic_init(&pool->next_task, 0);
+    pool->stealing = false;
+    if (!pool->threads || !pool->ranges) {
+        free(pool->threads);
+        free(pool->ranges);
+        free(pool);
+        return NULL;
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        atomic_init(&pool->ranges[i].bounds, 0);
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    // A pool that cannot start every thread still works with fewer workers
+    for (unsigned i = 1; i < threads; ++i) {
+        struct WorkerArg *wa = malloc(sizeof(struct WorkerArg));
+        if (!wa) break;
+        wa->pool = pool;
+        wa->worker = i;
+        if (pthread_create(&pool->threads[i - 1], NULL, worker_main, wa) != 0) {
+            free(wa);
+            break;
+        }
+        pool->size++;
+    }
+    return pool;
+}
+
+void threadpool_free(ThreadPool *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (unsigned i = 0; i + 1 < pool->size; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->ranges);
+    free(pool);
+}
+
+unsigned threadpool_size(const ThreadPool *pool) {
+    return pool ? pool->size : 1;
+}
+
+static void run_job(ThreadPool *pool, size_t n_tasks, ThreadPoolTask fn, void *ctx, bool stealing) {
+    if (n_tasks == 0 || !fn) return;
+
+    // Without a pool, or with nothing to share, run inline
+    if (!pool || pool->size == 1 || n_tasks == 1) {
+        for (size_t task = 0; task < n_tasks; ++task) {
+            fn(ctx, task, 0);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->n_tasks = n_tasks;
+    atomic_store_explicit(&pool->next_task, 0, memory_order_relaxed);
+    pool->stealing = stealing && n_tasks <= UINT32_MAX;
+    for (unsigned w = 0; pool->stealing && w < pool->size; ++w) {
+        // Worker w starts on the w-th contiguous share of the tasks
+        uint32_t begin = (uint32_t)(n_tasks * w / pool->size);
+        uint32_t end = (uint32_t)(n_tasks * (w + 1) / pool->size);
+        atomic_store_explicit(&pool->ranges[w].bounds, pack_range(begin, end), memory_order_relaxed);
+    }
+    pool->busy = pool->size - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    // The calling thread is worker 0
+    if (pool->stealing) {
+        drain_stealing(pool, 0);
+    } else {
+        drain(pool, 0);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void threadpool_run(ThreadPool *pool, size_t n_tasks, ThreadPoolTask fn, void *ctx) {
+    run_job(pool, n_tasks, fn, ctx, false);
+}
+
+void threadpool_run_stealing(ThreadPool *pool, size_t n_tasks, ThreadPoolTask fn, void *ctx) {
+    run_job(pool, n_tasks, fn, ctx, true);
+}
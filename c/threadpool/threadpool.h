@@ -0,0 +1,22 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stddef.h> // for size_t
+
+struct ThreadPool; // Fixed set of worker threads, see threadpool.c
+
+typedef void (*ThreadPoolTask)(void *ctx, size_t task, unsigned worker); // Runs task number `task` on worker `worker` (0 .. threads-1)
+
+struct ThreadPool *threadpool_create(unsigned threads); // Start a pool of `threads` workers (0 = one per online CPU), including the calling thread
+
+void threadpool_free(struct ThreadPool *pool); // Stop the workers and free the pool
+
+unsigned threadpool_size(const struct ThreadPool *pool); // Number of workers, including the calling thread
+
+void threadpool_run(struct ThreadPool *pool, size_t n_tasks, ThreadPoolTask fn, void *ctx); // Run tasks 0 .. n_tasks-1 across the workers and wait for all of them
+
+void threadpool_run_stealing(struct ThreadPool *pool, size_t n_tasks, ThreadPoolTask fn, void *ctx); // Like threadpool_run, but each worker starts on its own contiguous share of the tasks and steals half of another's remainder when it runs out; for many tasks of uneven cost
+
+unsigned threadpool_cpu_count(void); // Number of online CPUs (at least 1)
+
+#endif // THREADPOOL_H